@@ -1,419 +1,1611 @@
-/* maze_visualizer_fix.c
-   Fixes: correct parent handling so reconstructed path is valid.
-   Pure C, console "graphics" with ANSI background colors and double-space cells.
-*/
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-#include <string.h>
-
-#if defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-#include <conio.h>
-#else
-#include <unistd.h>
-#endif
-
-/* portable sleep ms */
-static void sleep_ms(int ms) {
-#if defined(_WIN32) || defined(_WIN64)
-	Sleep(ms);
-#else
-	if (ms > 0) usleep(ms * 1000);
-#endif
-}
-
-/* enable ANSI on Windows */
-static void enable_ansi_on_windows(void) {
-#if defined(_WIN32) || defined(_WIN64)
-	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-	if (hOut == INVALID_HANDLE_VALUE) return;
-	DWORD dwMode = 0;
-	if (!GetConsoleMode(hOut, &dwMode)) return;
-	dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-	SetConsoleMode(hOut, dwMode);
-#endif
-}
-
-/* terminal helpers */
-static void clear_screen(void) {
-	printf("\x1b[2J");
-}
-static void move_cursor_home(void) {
-	printf("\x1b[H");
-}
-static void hide_cursor(void) {
-	printf("\x1b[?25l");
-}
-static void show_cursor(void) {
-	printf("\x1b[?25h");
-}
-
-/* colors & blocks */
-#define COL_RESET "\x1b[0m"
-#define COL_WALL  "\x1b[48;2;20;28;36m"
-#define COL_EMPTY "\x1b[48;2;240;245;250m"
-#define COL_VISIT "\x1b[48;2;16;185;129m"
-#define COL_FRONT "\x1b[48;2;96;165;250m"
-#define COL_PATH  "\x1b[48;2;244;63;94m"
-#define COL_SE    "\x1b[48;2;251;191;36m"
-#define FULL_BLOCK "  "
-
-typedef unsigned char cell_t;
-typedef unsigned char mark_t;
-#define M_NONE 0
-#define M_VISIT 1
-#define M_FRONT 2
-#define M_PATH 4
-
-typedef struct {
-	int rows, cols;
-	cell_t *cells;
-	mark_t *marks;
-} Grid;
-
-static inline cell_t grid_get(const Grid *g, int r, int c) {
-	return g->cells[r * g->cols + c];
-}
-static inline void grid_set(Grid *g, int r, int c, cell_t v) {
-	g->cells[r * g->cols + c] = v;
-}
-static inline mark_t mark_get(const Grid *g, int r, int c) {
-	return g->marks[r * g->cols + c];
-}
-static inline void mark_or(Grid *g, int r, int c, mark_t v) {
-	g->marks[r * g->cols + c] |= v;
-}
-static inline void mark_andnot(Grid *g, int r, int c, mark_t v) {
-	g->marks[r * g->cols + c] &= ~v;
-}
-static inline void mark_set(Grid *g, int r, int c, mark_t v) {
-	g->marks[r * g->cols + c] = v;
-}
-
-static void grid_init(Grid *g, int rows, int cols) {
-	g->rows = rows;
-	g->cols = cols;
-	g->cells = (cell_t*)malloc(rows * cols);
-	g->marks = (mark_t*)malloc(rows * cols);
-	if (!g->cells || !g->marks) {
-		fprintf(stderr,"Out of memory\n");
-		exit(1);
-	}
-	memset(g->cells, 1, rows * cols);
-	memset(g->marks, M_NONE, rows * cols);
-}
-static void grid_free(Grid *g) {
-	free(g->cells);
-	free(g->marks);
-	g->cells = NULL;
-	g->marks = NULL;
-}
-
-static void shuffle_ints(int *arr, int n) {
-	for (int i = n-1; i > 0; --i) {
-		int j = rand() % (i+1);
-		int t = arr[i];
-		arr[i] = arr[j];
-		arr[j] = t;
-	}
-}
-
-/* generate perfect maze (iterative backtracker) */
-typedef struct {
-	int r,c;
-} CellRC;
-
-static void generate_maze(Grid *g) {
-	int rows = g->rows, cols = g->cols;
-	for (int r=0; r<rows; r++) for (int c=0; c<cols; c++) grid_set(g,r,c,1);
-	for (int r=1; r<rows; r+=2) for (int c=1; c<cols; c+=2) grid_set(g,r,c,0);
-
-	int maxcells = (rows/2)*(cols/2);
-	CellRC *stack = malloc(maxcells * sizeof(CellRC));
-	unsigned char *vis = calloc(rows*cols,1);
-	int top = 0;
-	stack[top++] = (CellRC) {
-		1,1
-	};
-	vis[1*cols + 1] = 1;
-
-	while (top > 0) {
-		CellRC cur = stack[top-1];
-		int r = cur.r, c = cur.c;
-		int dirs[4][2] = {{-2,0},{2,0},{0,-2},{0,2}};
-		int choices[4], ch=0;
-		for (int i=0; i<4; i++) {
-			int nr = r + dirs[i][0], nc = c + dirs[i][1];
-			if (nr>0 && nr<rows-1 && nc>0 && nc<cols-1) {
-				if (!vis[nr*cols + nc]) choices[ch++]=i;
-			}
-		}
-		if (ch>0) {
-			int pick = choices[rand()%ch];
-			int nr = r + dirs[pick][0], nc = c + dirs[pick][1];
-			int wr = r + dirs[pick][0]/2, wc = c + dirs[pick][1]/2;
-			grid_set(g, wr, wc, 0);
-			vis[nr*cols + nc]=1;
-			stack[top++] = (CellRC) {
-				nr,nc
-			};
-		} else {
-			--top;
-		}
-	}
-	free(stack);
-	free(vis);
-}
-
-/* draw */
-static void draw_grid(const Grid *g, int sr, int sc, int er, int ec) {
-	move_cursor_home();
-	for (int r=0; r<g->rows; r++) {
-		for (int c=0; c<g->cols; c++) {
-			if (r==sr && c==sc) {
-				printf("%s%s%s", COL_SE, FULL_BLOCK, COL_RESET);
-				continue;
-			}
-			if (r==er && c==ec) {
-				printf("%s%s%s", COL_SE, FULL_BLOCK, COL_RESET);
-				continue;
-			}
-			cell_t cell = grid_get(g,r,c);
-			mark_t m = mark_get(g,r,c);
-			if (cell==1) printf("%s%s%s", COL_WALL, FULL_BLOCK, COL_RESET);
-			else if (m & M_PATH) printf("%s%s%s", COL_PATH, FULL_BLOCK, COL_RESET);
-			else if (m & M_FRONT) printf("%s%s%s", COL_FRONT, FULL_BLOCK, COL_RESET);
-			else if (m & M_VISIT) printf("%s%s%s", COL_VISIT, FULL_BLOCK, COL_RESET);
-			else printf("%s%s%s", COL_EMPTY, FULL_BLOCK, COL_RESET);
-		}
-		printf("\n");
-	}
-	fflush(stdout);
-}
-
-/* small data structures */
-typedef struct {
-	CellRC *data;
-	int top, cap;
-} Stack;
-static Stack *stack_create(int cap) {
-	Stack*s=malloc(sizeof(Stack));
-	s->data=malloc(sizeof(CellRC)*cap);
-	s->top=0;
-	s->cap=cap;
-	return s;
-}
-static void stack_push(Stack*s, CellRC v) {
-	if (s->top < s->cap) s->data[s->top++]=v;
-}
-static CellRC stack_pop(Stack*s) {
-	return s->data[--s->top];
-}
-static int stack_empty(Stack*s) {
-	return s->top==0;
-}
-static void stack_free(Stack*s) {
-	free(s->data);
-	free(s);
-}
-
-typedef struct {
-	CellRC *data;
-	int head, tail, cap;
-} Queue;
-static Queue* queue_create(int cap) {
-	Queue*q=malloc(sizeof(Queue));
-	q->data=malloc(sizeof(CellRC)*cap);
-	q->head=q->tail=0;
-	q->cap=cap;
-	return q;
-}
-static void queue_push(Queue*q, CellRC v) {
-	q->data[q->tail++]=v;
-	if (q->tail>=q->cap) q->tail=0;
-}
-static CellRC queue_pop(Queue*q) {
-	CellRC v=q->data[q->head++];
-	if (q->head>=q->cap) q->head=0;
-	return v;
-}
-static int queue_empty(const Queue*q) {
-	return q->head==q->tail;
-}
-static void queue_free(Queue*q) {
-	free(q->data);
-	free(q);
-}
-
-/* helpers */
-static int is_inside(const Grid*g,int r,int c) {
-	return r>=0 && r<g->rows && c>=0 && c<g->cols;
-}
-static const int nbrs4[4][2] = {{-1,0},{1,0},{0,-1},{0,1}};
-
-/* reconstruct path using parent[] (only if parent set) */
-static void reconstruct_and_mark(Grid *g, int *parent, int cols, int er, int ec, int delay_ms) {
-	int idx = er * cols + ec;
-	if (parent[idx] == -1) return; /* no path */
-	int cur = idx;
-	while (cur != -2 && cur != -1) {
-		int rr = cur / cols, cc = cur % cols;
-		mark_or(g, rr, cc, M_PATH);
-		cur = parent[cur];
-		draw_grid(g, /*sr*/1, /*sc*/1, er, ec); /* we pass sr/sc just for drawing */
-		sleep_ms(delay_ms);
-	}
-}
-
-/* BFS - shortest path */
-static void solve_bfs(Grid *g, int sr, int sc, int er, int ec, int delay_ms) {
-	int rows = g->rows, cols = g->cols;
-	int *parent = malloc(sizeof(int)*rows*cols);
-	for (int i=0; i<rows*cols; i++) parent[i] = -1;
-	memset(g->marks, M_NONE, rows*cols);
-
-	Queue *q = queue_create(rows*cols + 5);
-	queue_push(q, (CellRC) {
-		sr,sc
-	});
-	parent[sr*cols + sc] = -2; /* root */
-	mark_or(g, sr, sc, M_FRONT);
-
-	while (!queue_empty(q)) {
-		CellRC cur = queue_pop(q);
-		int r=cur.r, c=cur.c;
-		mark_andnot(g, r, c, M_FRONT);
-		if (!(g->marks[r*cols + c] & M_VISIT)) {
-			mark_or(g, r, c, M_VISIT);
-			draw_grid(g, sr, sc, er, ec);
-			sleep_ms(delay_ms);
-		}
-		if (r==er && c==ec) break;
-		for (int k=0; k<4; k++) {
-			int nr=r + nbrs4[k][0], nc = c + nbrs4[k][1];
-			if (is_inside(g,nr,nc) && grid_get(g,nr,nc)==0 && parent[nr*cols + nc] == -1) {
-				parent[nr*cols + nc] = r*cols + c; /* set parent only once when discovered */
-				queue_push(q, (CellRC) {
-					nr,nc
-				});
-				mark_or(g, nr, nc, M_FRONT);
-			}
-		}
-	}
-	reconstruct_and_mark(g, parent, cols, er, ec, delay_ms);
-	queue_free(q);
-	free(parent);
-}
-
-/* DFS iterative - parent set only when discovered (prevents wrong overwrites) */
-static void solve_dfs(Grid *g, int sr, int sc, int er, int ec, int delay_ms) {
-	int rows = g->rows, cols = g->cols;
-	int *parent = malloc(sizeof(int)*rows*cols);
-	for (int i=0; i<rows*cols; i++) parent[i] = -1;
-	memset(g->marks, M_NONE, rows*cols);
-
-	Stack *st = stack_create(rows*cols + 5);
-	stack_push(st, (CellRC) {
-		sr,sc
-	});
-	parent[sr*cols + sc] = -2;
-	mark_or(g, sr, sc, M_FRONT);
-
-	while (!stack_empty(st)) {
-		CellRC cur = stack_pop(st);
-		int r = cur.r, c = cur.c;
-		mark_andnot(g, r, c, M_FRONT);
-
-		if (!(g->marks[r*cols + c] & M_VISIT)) {
-			mark_or(g, r, c, M_VISIT);
-			draw_grid(g, sr, sc, er, ec);
-			sleep_ms(delay_ms);
-		}
-		if (r==er && c==ec) break;
-
-		int order[4] = {0,1,2,3};
-		shuffle_ints(order,4);
-		for (int i=0; i<4; i++) {
-			int k = order[i];
-			int nr = r + nbrs4[k][0], nc = c + nbrs4[k][1];
-			if (is_inside(g,nr,nc) && grid_get(g,nr,nc)==0 && g->marks[nr*cols + nc] == M_NONE) {
-				/* If parent not set, set it now and push */
-				if (parent[nr*cols + nc] == -1) parent[nr*cols + nc] = r*cols + c;
-				stack_push(st, (CellRC) {
-					nr,nc
-				});
-				mark_or(g, nr, nc, M_FRONT);
-			}
-		}
-	}
-
-	reconstruct_and_mark(g, parent, cols, er, ec, delay_ms);
-	stack_free(st);
-	free(parent);
-}
-
-/* helper input */
-static int get_int_with_default(const char *prompt, int def) {
-	char buf[128];
-	printf("%s (default %d): ", prompt, def);
-	if (!fgets(buf, sizeof(buf), stdin)) return def;
-	int x;
-	if (sscanf(buf, "%d", &x) == 1) return x;
-	return def;
-}
-
-int main(void) {
-	srand((unsigned)time(NULL));
-	enable_ansi_on_windows();
-	hide_cursor();
-	atexit(show_cursor);
-
-	printf("\nMAZE VISUALIZER- C\n");
-	
-	int cols = get_int_with_default("Enter odd number of columns", 31);
-	int rows = get_int_with_default("Enter odd number of rows", 21);
-	if (cols < 11) cols = 11;
-	if (rows < 11) rows = 11;
-	if (cols % 2 == 0) cols++;
-	if (rows % 2 == 0) rows++;
-
-	int algo_choice = get_int_with_default("Choose algorithm: 1=DFS (explore), 2=BFS (shortest)", 2);
-	int delay = get_int_with_default("Animation delay in ms (0..200), smaller -> faster", 40);
-
-	Grid g;
-	grid_init(&g, rows, cols);
-	int sr = 1, sc = 1, er = rows-2, ec = cols-2;
-
-	while (1) {
-		generate_maze(&g);
-		clear_screen();
-		move_cursor_home();
-		draw_grid(&g, sr, sc, er, ec);
-		printf("\nGenerated maze %dx%d. Press Enter to start solver", cols, rows);
-		fflush(stdout);
-		getchar();
-
-		if (algo_choice == 1) solve_dfs(&g, sr, sc, er, ec, delay);
-		else solve_bfs(&g, sr, sc, er, ec, delay);
-
-		draw_grid(&g, sr, sc, er, ec);
-		printf("\nSolver finished. Options:\n[r] Regenerate  [a] Toggle algorithm  [q] Quit\n");
-		int c = getchar();
-		if (c == '\n') c = getchar();
-		if (c == 'q' || c == 'Q') break;
-		if (c == 'a' || c == 'A') {
-			algo_choice = (algo_choice==1) ? 2 : 1;
-			printf("Toggled algorithm to %s\n", algo_choice==1?"DFS":"BFS");
-			printf("Press Enter: ");
-			getchar();
-		}
-	}
-
-	grid_free(&g);
-	clear_screen();
-	show_cursor();
-	printf("Thank you!\n");
-	return 0;
-}
+/* MazeSolver.c - the maze program, a front end over libmaze: the
+   interactive visualizer and wall editor, and the bench, suite, batch,
+   replay, server and load generator modes. Links libmaze statically and
+   uses its internals (maze_internal.h) as well as the public API.
+*/
+
+#include "maze_internal.h"
+
+
+/* raw single-key input for the wall editor and viewport panning */
+static int raw_active;
+#if defined(_WIN32) || defined(_WIN64)
+static void raw_mode(int on) {
+	raw_active = on;
+}
+static int read_key(void) {
+	int c = _getch();
+	if (c == 0 || c == 0xE0) {
+		c = _getch();
+		return c==72 ? KEY_UP : c==80 ? KEY_DOWN : c==75 ? KEY_LEFT : c==77 ? KEY_RIGHT : 0;
+	}
+	return c;
+}
+/* a pending key or 0, without blocking; only in raw mode */
+static int poll_key(void) {
+	return raw_active && _kbhit() ? read_key() : 0;
+}
+#else
+static void raw_mode(int on) {
+	static struct termios saved;
+	struct termios t;
+	if (on) {
+		if (tcgetattr(0, &saved)) return; /* not a terminal: keys stay line-buffered */
+		raw_active = 1;
+		t = saved;
+		t.c_lflag &= ~(ICANON | ECHO);
+		t.c_cc[VMIN] = 1;
+		t.c_cc[VTIME] = 0;
+		tcsetattr(0, TCSANOW, &t);
+	} else if (raw_active) {
+		raw_active = 0;
+		tcsetattr(0, TCSANOW, &saved);
+	}
+}
+static int read_key(void) {
+	int c = getchar();
+	if (c == 27 && getchar() == '[') {
+		c = getchar();
+		return c=='A' ? KEY_UP : c=='B' ? KEY_DOWN : c=='D' ? KEY_LEFT : c=='C' ? KEY_RIGHT : 0;
+	}
+	return c;
+}
+/* reads the fd directly, so it must not be mixed with buffered getchar input */
+static int poll_key(void) {
+	unsigned char b[8];
+	fd_set fds;
+	struct timeval tv = { 0, 0 };
+	if (!raw_active) return 0;
+	FD_ZERO(&fds);
+	FD_SET(0, &fds);
+	if (select(1, &fds, NULL, NULL, &tv) <= 0) return 0;
+	ssize_t n = read(0, b, sizeof b);
+	if (n <= 0) return 0;
+	if (n >= 3 && b[0] == 27 && b[1] == '[')
+		return b[2]=='A' ? KEY_UP : b[2]=='B' ? KEY_DOWN : b[2]=='D' ? KEY_LEFT : b[2]=='C' ? KEY_RIGHT : 0;
+	return b[0];
+}
+#endif
+
+
+/* animation, GIF recording and tracing observe the solvers; solves with
+   nothing watching get no observer and run headless */
+static Recorder *recorder;
+static Trace *tracer;
+typedef struct {
+	int sr, sc, er, ec;
+	int delay_ms; /* negative = no drawing */
+} Anim;
+
+/* every solver mark moves the view focus and updates the overview and trace */
+static void note_mark(const Grid *g, int u, int ev, mark_t before) {
+	view_focus = u;
+	if (overview) overview_mark(overview, u, before, g->marks[u]);
+	if (tracer) trace_event(tracer, g, u, ev);
+}
+/* one animation frame */
+static void anim_frame(const Anim *a, const Grid *g) {
+	if (recorder) {
+#ifndef MAZE_NO_STATS
+		double t0 = now_ms();
+		recorder_step(recorder, g, a->sr, a->sc, a->er, a->ec);
+		stats.phase_ms[PH_RENDER] += now_ms() - t0;
+#else
+		recorder_step(recorder, g, a->sr, a->sc, a->er, a->ec);
+#endif
+	}
+	if (a->delay_ms < 0) return;
+	for (int key; (key = poll_key()); ) view_pan(key);
+	draw_grid(g, a->sr, a->sc, a->er, a->ec);
+	stats_sleep(a->delay_ms);
+}
+static void anim_frontier(void *ctx, const Grid *g, int cell, int before) {
+	(void)ctx;
+	note_mark(g, grid_at(g, cell), EV_FRONT, (mark_t)before);
+}
+/* frames follow expanded cells and path cells */
+static void anim_visit(void *ctx, const Grid *g, int cell, int before) {
+	note_mark(g, grid_at(g, cell), EV_VISIT, (mark_t)before);
+	anim_frame(ctx, g);
+}
+static void anim_path(void *ctx, const Grid *g, int cell, int before) {
+	note_mark(g, grid_at(g, cell), EV_PATH, (mark_t)before);
+	anim_frame(ctx, g);
+}
+
+static long solve(int algo, Grid *g, int sr, int sc, int er, int ec, int delay_ms) {
+	Anim a = { sr, sc, er, ec, delay_ms };
+	MazeObserver obs = { anim_frontier, anim_visit, anim_path, NULL, &a };
+	if (!(delay_ms >= 0 || recorder || tracer || overview)) return run_solver(algo, g, sr, sc, er, ec, NULL);
+	if (overview) overview_reset(overview); /* the solver starts from clear marks */
+	return run_solver(algo, g, sr, sc, er, ec, &obs);
+}
+
+
+/* --stats summary on stderr and --stats-json dump, written at exit */
+static const char *stats_json_path;
+static int stats_wanted;
+static void stats_report(void) {
+#ifndef MAZE_NO_STATS
+	if (stats_wanted) {
+		fprintf(stderr, "stats: %llu generations, %llu solves, %llu frames (%.1f KB written), %llu allocations (%.1f MB)\n",
+		        stats.gens, stats.solves, stats.draws, stats.draw_bytes / 1024.0, alloc_count, alloc_bytes / 1048576.0);
+		fprintf(stderr, "       %llu pushes, %llu pops, max depth %llu, %llu neighbours checked\n",
+		        stats.pushes, stats.pops, stats.max_depth, stats.neighbours);
+		fprintf(stderr, "       time:");
+		for (int i=0; i<PH_COUNT; i++) fprintf(stderr, " %s %.2f ms%s", phase_names[i], stats.phase_ms[i], i+1 < PH_COUNT ? "," : "\n");
+	}
+	if (stats_json_path) {
+		FILE *f = strcmp(stats_json_path, "-") ? fopen(stats_json_path, "w") : stdout;
+		if (!f) {
+			fprintf(stderr, "%s: cannot write\n", stats_json_path);
+			return;
+		}
+		fprintf(f, "{\"enabled\":true,\"generations\":%llu,\"solves\":%llu,\"frames\":%llu,\"frame_bytes\":%llu,"
+		        "\"allocations\":%llu,\"alloc_bytes\":%llu,\"pushes\":%llu,\"pops\":%llu,\"max_depth\":%llu,"
+		        "\"neighbours\":%llu,\"peak_rss_kb\":%ld,\"phase_ms\":{", stats.gens, stats.solves, stats.draws,
+		        stats.draw_bytes, alloc_count, alloc_bytes, stats.pushes, stats.pops, stats.max_depth, stats.neighbours,
+		        peak_rss_kb());
+		for (int i=0; i<PH_COUNT; i++) fprintf(f, "\"%s\":%.3f%s", phase_names[i], stats.phase_ms[i], i+1 < PH_COUNT ? "," : "}}\n");
+		if (f != stdout) fclose(f);
+	}
+#else
+	if (stats_wanted) fprintf(stderr, "stats: compiled out (MAZE_NO_STATS)\n");
+	if (stats_json_path) {
+		FILE *f = strcmp(stats_json_path, "-") ? fopen(stats_json_path, "w") : stdout;
+		if (f) {
+			fprintf(f, "{\"enabled\":false}\n");
+			if (f != stdout) fclose(f);
+		}
+	}
+#endif
+}
+
+/* helper input */
+static int get_int_with_default(const char *prompt, int def) {
+	char buf[128];
+	printf("%s (default %d): ", prompt, def);
+	if (!fgets(buf, sizeof(buf), stdin)) return def;
+	int x;
+	if (sscanf(buf, "%d", &x) == 1) return x;
+	return def;
+}
+
+/* headless benchmark: every solver on one generated grid, no drawing */
+static int odd_at_least_11(int n) {
+	if (n < 11) n = 11;
+	return n % 2 ? n : n+1;
+}
+
+#define BENCH_EDITS 50
+#define BENCH_QUERIES 50
+#define BENCH_GOALS 16
+
+static int random_open_cell(const Grid *g) {
+	for (;;) {
+		int u = grid_at(g, rng_int() % (g->rows * g->cols));
+		if (!cell_is_wall(g->cells[u])) return u;
+	}
+}
+
+static void run_bench(Grid *gp, const char *label, unsigned seed) {
+	Grid g = *gp;
+	int rows = g.rows, cols = g.cols;
+	int sr = 1, sc = 1, er = rows-2, ec = cols-2;
+	rng_seed(seed);
+
+	double t0 = now_ms();
+	jps_table_build(&jps_cache, &g);
+	double jps_ms = now_ms() - t0;
+	t0 = now_ms();
+	if (hpa_cache) hpa_free(hpa_cache);
+	hpa_cache = hpa_create(&g);
+	double hpa_build_ms = now_ms() - t0;
+	t0 = now_ms();
+	if (alt_cache) landmarks_free(alt_cache);
+	alt_cache = landmarks_build(&g, ALT_LANDMARKS, alt_threads);
+	printf("%s %dx%d seed %u, JPS+ table built in %.2f ms, HPA* abstraction in %.2f ms, %d ALT landmarks in %.2f ms\n",
+	       label, cols, rows, seed, jps_ms, hpa_build_ms, alt_cache->k, now_ms() - t0);
+	printf("%-10s %10s %8s %8s %10s\n", "solver", "expanded", "path", "cost", "ms");
+	for (int a=1; a<=ALGO_COUNT; a++) {
+		t0 = now_ms();
+		solve(a, &g, sr, sc, er, ec, -1);
+		double ms = now_ms() - t0;
+		long expanded = 0, path = 0, cost = 0;
+		for (int i=0; i<g.n; i++) {
+			if (g.marks[i] & M_VISIT) expanded++;
+			if (g.marks[i] & M_PATH) {
+				path++;
+				if (i != grid_index(&g, sr, sc)) cost += cell_cost(g.cells[i]);
+			}
+		}
+		printf("%-10s %10ld %8ld %8ld %10.3f\n", algo_names[a], expanded, path, cost, ms);
+	}
+
+	/* incremental repair after single wall toggles, against a fresh A* */
+	grid_make_writable(&g);
+	Lpa *l = lpa_create(&g, sr, sc, er, ec);
+	t0 = now_ms();
+	lpa_compute(l);
+	printf("LPA* initial solve: %ld expanded, %.3f ms\n", l->expanded, now_ms() - t0);
+	double repair_ms = 0, full_ms = 0;
+	long repair_exp = 0, full_exp = 0;
+	for (int i=0; i<BENCH_EDITS; i++) {
+		int r = 1 + rng_int()%(rows-2), u = grid_index(&g, r, 1 + rng_int()%(cols-2));
+		t0 = now_ms();
+		lpa_toggle(l, &u, 1);
+		lpa_compute(l);
+		repair_ms += now_ms() - t0;
+		repair_exp += l->expanded;
+		t0 = now_ms();
+		solve_astar(&g, sr, sc, er, ec);
+		full_ms += now_ms() - t0;
+		scratch_reset();
+		for (int j=0; j<g.n; j++) full_exp += (g.marks[j] & M_VISIT) != 0;
+	}
+	printf("%d wall toggles: LPA* repair %ld expanded / %.3f ms avg, A* re-solve %ld expanded / %.3f ms avg\n",
+	       BENCH_EDITS, repair_exp / BENCH_EDITS, repair_ms / BENCH_EDITS, full_exp / BENCH_EDITS, full_ms / BENCH_EDITS);
+	lpa_free(l);
+
+	/* many queries on one abstraction: HPA* latency and path quality vs A*;
+	   the toggles above changed the grid, so the abstraction is rebuilt */
+	t0 = now_ms();
+	hpa_free(hpa_cache);
+	hpa_cache = hpa_create(&g);
+	printf("HPA* preprocessing: %.3f ms\n", now_ms() - t0);
+	double hpa_ms = 0, astar_ms = 0, ratio = 0;
+	int answered = 0;
+	for (int i=0; i<BENCH_QUERIES; i++) {
+		int s = random_open_cell(&g), t = random_open_cell(&g);
+		memset(g.marks, M_NONE, g.n);
+		t0 = now_ms();
+		int hc = hpa_query(hpa_cache, s, t, NULL);
+		hpa_ms += now_ms() - t0;
+		t0 = now_ms();
+		solve_astar(&g, grid_row(&g, s), grid_col(&g, s), grid_row(&g, t), grid_col(&g, t));
+		astar_ms += now_ms() - t0;
+		scratch_reset();
+		long ac = 0;
+		for (int j=0; j<g.n; j++)
+			if ((g.marks[j] & M_PATH) && j != s) ac += cell_cost(g.cells[j]);
+		if (hc < LPA_INF && ac > 0) {
+			ratio += (double)hc / ac;
+			answered++;
+		}
+	}
+	printf("%d random queries: HPA* %.3f ms avg, A* %.3f ms avg, HPA*/optimal cost %.3f\n",
+	       BENCH_QUERIES, hpa_ms / BENCH_QUERIES, astar_ms / BENCH_QUERIES, answered ? ratio / answered : 1.0);
+	t0 = now_ms();
+	for (int i=0; i<BENCH_EDITS; i++) {
+		int r = 1 + rng_int()%(rows-2), u = grid_index(&g, r, 1 + rng_int()%(cols-2));
+		g.cells[u] ^= CELL_WALL;
+		grid_touch(&g);
+		hpa_update(hpa_cache, u);
+	}
+	printf("HPA* cluster-local update after a wall toggle: %.3f ms avg\n", (now_ms() - t0) / BENCH_EDITS);
+
+	/* "visit all checkpoints" and "nearest exit": one multi-target or
+	   multi-source sweep against a BFS per goal */
+	int one = grid_rm(&g, random_open_cell(&g)), goals[BENCH_GOALS];
+	for (int i=0; i<BENCH_GOALS; i++) goals[i] = grid_rm(&g, random_open_cell(&g));
+	long sweep_steps = 0, bfs_steps = 0, nearest = -1, bfs_nearest = -1;
+	t0 = now_ms();
+	MazeMulti *m = maze_search_multi(&g, &one, 1, goals, BENCH_GOALS, MAZE_STOP_ALL, NULL);
+	for (int i=0; i<BENCH_GOALS; i++) sweep_steps += maze_multi_path(m, goals[i], NULL, 0);
+	maze_multi_free(m);
+	double sweep_ms = now_ms() - t0;
+	t0 = now_ms();
+	m = maze_search_multi(&g, goals, BENCH_GOALS, &one, 1, MAZE_STOP_ANY, NULL);
+	nearest = maze_multi_path(m, one, NULL, 0);
+	maze_multi_free(m);
+	double nearest_ms = now_ms() - t0;
+	t0 = now_ms();
+	for (int i=0; i<BENCH_GOALS; i++) {
+		long p = run_solver(MAZE_BFS, &g, one / cols, one % cols, goals[i] / cols, goals[i] % cols, NULL) - 1;
+		bfs_steps += p;
+		if (p >= 0 && (bfs_nearest < 0 || p < bfs_nearest)) bfs_nearest = p;
+	}
+	double bfs_ms = now_ms() - t0;
+	printf("%d checkpoints: one sweep %.3f ms, %d BFS %.3f ms (%ld steps, %s); nearest of %d exits: one sweep %.3f ms (%ld steps, %s)\n",
+	       BENCH_GOALS, sweep_ms, BENCH_GOALS, bfs_ms, sweep_steps, sweep_steps == bfs_steps ? "same" : "MISMATCH",
+	       BENCH_GOALS, nearest_ms, nearest, nearest == bfs_nearest ? "same" : "MISMATCH");
+
+	/* all-pairs oracle, only for small mazes */
+	t0 = now_ms();
+	DistOracle *o = oracle_build(&g, alt_threads);
+	if (!o) printf("distance oracle skipped: more than %d open cells\n", ORACLE_MAX_CELLS);
+	else {
+		double build_ms = now_ms() - t0;
+		long sum = 0;
+		t0 = now_ms();
+		for (int i=0; i<BENCH_QUERIES*1000; i++)
+			sum += oracle_dist(o, o->cell_of[rng_int() % o->n], o->cell_of[rng_int() % o->n]);
+		printf("distance oracle: %d cells, %.1f MB, built in %.2f ms on %d threads, %.1f ns/query (checksum %ld)\n",
+		       o->n, (double)o->n*o->n*2 / (1<<20), build_ms, alt_threads,
+		       (now_ms() - t0) * 1e6 / (BENCH_QUERIES*1000), sum);
+		oracle_free(o);
+	}
+	*gp = g;
+}
+
+/* benchmark suite: every generator, solver and a full/diff frame of
+   draw_grid over a matrix of sizes and seeds, with warmup runs, the
+   median and p95 of timed repetitions, allocations per run and the peak
+   RSS so far. Results go to a table and optionally JSON, one result per
+   line; --baseline reads such a file back and flags slowdowns. */
+#define SUITE_MAX_SIZES 16
+#define SUITE_MAX_REPS 1000
+#define SUITE_TOLERANCE 1.10 /* median slower than the baseline by this factor is a regression */
+#define SUITE_NOISE_MS 0.05  /* ... unless it is only this much slower */
+
+typedef struct {
+	char name[48];
+	int size;
+	unsigned seed;
+	double median_ms, p95_ms, cells_per_s;
+	unsigned long long allocs, alloc_bytes;
+	long rss_kb;
+} SuiteResult;
+
+typedef struct {
+	int reps, warmup;
+	SuiteResult *res;
+	int n, cap;
+} Suite;
+
+static int cmp_double(const void *a, const void *b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return x < y ? -1 : x > y;
+}
+
+enum { SUITE_GEN, SUITE_SOLVE, SUITE_DRAW_FULL, SUITE_DRAW_DIFF };
+
+/* one warmed-up, repeated measurement */
+static void suite_case(Suite *st, Grid *g, int kind, int which, int gen, int size, unsigned seed) {
+	double ms[SUITE_MAX_REPS];
+	unsigned long long a0 = 0, b0 = 0;
+	int sr = 1, sc = 1, er = g->rows-2, ec = g->cols-2;
+	for (int i = -st->warmup; i < st->reps; i++) {
+		if (i == 0) {
+			a0 = alloc_count;
+			b0 = alloc_bytes;
+		}
+		if (kind == SUITE_GEN) memset(g->cells, CELL_WALL, g->n);
+		if (kind == SUITE_DRAW_FULL) view_dirty = 1;
+		rng_seed(seed);
+		double t0 = now_ms();
+		if (kind == SUITE_GEN) run_generator(which, g);
+		else if (kind == SUITE_SOLVE) solve(which, g, sr, sc, er, ec, -1);
+		else draw_grid(g, sr, sc, er, ec);
+		if (i >= 0) ms[i] = now_ms() - t0;
+	}
+	if (st->n == st->cap) {
+		st->cap = st->cap ? st->cap*2 : 64;
+		st->res = xrealloc(st->res, sizeof(SuiteResult) * st->cap);
+	}
+	SuiteResult *r = &st->res[st->n++];
+	memset(r, 0, sizeof *r);
+	if (kind == SUITE_GEN) snprintf(r->name, sizeof r->name, "gen/%s", gen_names[which]);
+	else if (kind == SUITE_SOLVE) snprintf(r->name, sizeof r->name, "solve/%s/%s", algo_names[which], gen_names[gen]);
+	else snprintf(r->name, sizeof r->name, "draw/%s/%s", kind == SUITE_DRAW_FULL ? "full" : "diff", gen_names[gen]);
+	r->size = size;
+	r->seed = seed;
+	qsort(ms, st->reps, sizeof(double), cmp_double);
+	r->median_ms = st->reps % 2 ? ms[st->reps/2] : (ms[st->reps/2 - 1] + ms[st->reps/2]) / 2;
+	r->p95_ms = ms[(st->reps * 95 + 99) / 100 - 1];
+	r->cells_per_s = (double)g->rows * g->cols / (r->median_ms > 1e-6 ? r->median_ms / 1000 : 1e-9);
+	r->allocs = (alloc_count - a0) / st->reps;
+	r->alloc_bytes = (alloc_bytes - b0) / st->reps;
+	r->rss_kb = peak_rss_kb();
+	printf("%-28s %6d %6u %10.3f %10.3f %12.0f %8llu %10llu %9ld\n", r->name, r->size, r->seed, r->median_ms,
+	       r->p95_ms, r->cells_per_s, r->allocs, r->alloc_bytes, r->rss_kb);
+	fflush(stdout);
+}
+
+static void suite_json(const Suite *st, FILE *f) {
+	fprintf(f, "{\"version\":1,\"reps\":%d,\"warmup\":%d,\"threads\":%d,\"results\":[\n", st->reps, st->warmup, alt_threads);
+	for (int i=0; i<st->n; i++) {
+		const SuiteResult *r = &st->res[i];
+		fprintf(f, "{\"name\":\"%s\",\"size\":%d,\"seed\":%u,\"median_ms\":%.6f,\"p95_ms\":%.6f,\"cells_per_s\":%.0f,"
+		        "\"allocs\":%llu,\"alloc_bytes\":%llu,\"peak_rss_kb\":%ld}%s\n", r->name, r->size, r->seed, r->median_ms,
+		        r->p95_ms, r->cells_per_s, r->allocs, r->alloc_bytes, r->rss_kb, i+1 < st->n ? "," : "");
+	}
+	fprintf(f, "]}\n");
+}
+
+/* compares medians with a file written by suite_json; returns the number
+   of regressions, -1 if the file can't be read */
+static int suite_compare(const Suite *st, const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f) return -1;
+	char line[512];
+	int regressions = 0, matched = 0;
+	printf("\n%-28s %6s %6s %10s %10s %8s\n", "vs baseline", "size", "seed", "base ms", "ms", "ratio");
+	while (fgets(line, sizeof line, f)) {
+		SuiteResult b;
+		if (sscanf(line, "{\"name\":\"%47[^\"]\",\"size\":%d,\"seed\":%u,\"median_ms\":%lf", b.name, &b.size, &b.seed, &b.median_ms) != 4)
+			continue;
+		for (int i=0; i<st->n; i++) {
+			const SuiteResult *r = &st->res[i];
+			if (strcmp(r->name, b.name) || r->size != b.size || r->seed != b.seed) continue;
+			double ratio = b.median_ms > 1e-6 ? r->median_ms / b.median_ms : 1.0;
+			int slow = ratio > SUITE_TOLERANCE && r->median_ms - b.median_ms > SUITE_NOISE_MS;
+			regressions += slow;
+			matched++;
+			printf("%-28s %6d %6u %10.3f %10.3f %7.2fx%s\n", r->name, r->size, r->seed, b.median_ms, r->median_ms, ratio,
+			       slow ? "  REGRESSION" : "");
+		}
+	}
+	fclose(f);
+	printf("%d of %d results matched the baseline, %d regressions (tolerance %.0f%%)\n", matched, st->n, regressions,
+	       (SUITE_TOLERANCE - 1) * 100);
+	return regressions;
+}
+
+/* returns the process exit status: 1 on regressions or write errors */
+static int run_suite(const int *sizes, int nsizes, unsigned seed, int nseeds, int reps, int warmup,
+                     const char *json_path, const char *baseline_path) {
+	Suite st = { reps < 1 ? 1 : reps > SUITE_MAX_REPS ? SUITE_MAX_REPS : reps, warmup < 0 ? 0 : warmup, NULL, 0, 0 };
+	FILE *sink = fopen(NULL_DEVICE, "w");
+	draw_sink = sink;
+	view.mode = RENDER_BLOCK;
+	view.follow = 0;
+	printf("%-28s %6s %6s %10s %10s %12s %8s %10s %9s\n", "case", "size", "seed", "median ms", "p95 ms",
+	       "cells/s", "allocs", "bytes", "rss KB");
+	for (int si=0; si<nsizes; si++) {
+		int size = odd_at_least_11(sizes[si]);
+		for (int k=0; k<nseeds; k++) {
+			Grid g;
+			grid_init(&g, size, size);
+			/* whole maze in one frame for the draw cases */
+			term_resized = 0;
+			view.tr = size + VIEW_RESERVED;
+			view.tc = 2 * size;
+			for (int gen=0; gen<GEN_COUNT; gen++) {
+				suite_case(&st, &g, SUITE_GEN, gen, gen, size, seed + k);
+				for (int a=1; a<=ALGO_COUNT; a++) suite_case(&st, &g, SUITE_SOLVE, a, gen, size, seed + k);
+				suite_case(&st, &g, SUITE_DRAW_FULL, 0, gen, size, seed + k);
+				suite_case(&st, &g, SUITE_DRAW_DIFF, 0, gen, size, seed + k);
+			}
+			grid_free(&g);
+		}
+	}
+	draw_sink = NULL;
+	if (sink) fclose(sink);
+	int status = 0;
+	if (json_path) {
+		FILE *f = strcmp(json_path, "-") ? fopen(json_path, "w") : stdout;
+		if (!f) {
+			fprintf(stderr, "%s: cannot write\n", json_path);
+			status = 1;
+		} else {
+			suite_json(&st, f);
+			if (f != stdout) fclose(f);
+		}
+	}
+	if (baseline_path) {
+		int reg = suite_compare(&st, baseline_path);
+		if (reg < 0) fprintf(stderr, "%s: cannot read baseline\n", baseline_path);
+		if (reg) status = 1;
+	}
+	free(st.res);
+	return status;
+}
+
+
+/* batch mode: independent (generate, solve) jobs on a work-stealing pool.
+   Each worker owns a range of job numbers and takes from its front; an idle
+   worker steals the back half of the largest range left. Workers keep their
+   own grid and (thread-local) solver caches, and every job reseeds the
+   worker's PRNG from the master seed and its number, so the results don't
+   depend on scheduling or the thread count. */
+typedef struct {
+	mutex_t lock;
+	int lo, hi; /* jobs not yet claimed */
+} BatchRange;
+
+typedef struct {
+	int rows, cols, gen, algo, nthreads;
+	unsigned long long seed;
+	BatchRange range[MAX_THREADS];
+} Batch;
+
+typedef struct {
+	Batch *b;
+	int id;
+	long jobs, steals, solved;
+	unsigned long long expanded, path, cost;
+	double gen_ms, solve_ms;
+	unsigned long long allocs, alloc_bytes;
+#ifndef MAZE_NO_STATS
+	Stats stats;
+#endif
+} BatchWorker;
+
+/* next job for worker id, -1 once every range is empty */
+static int batch_next(Batch *b, int id, long *steals) {
+	BatchRange *own = &b->range[id];
+	mutex_lock(&own->lock);
+	int j = own->lo < own->hi ? own->lo++ : -1;
+	mutex_unlock(&own->lock);
+	while (j < 0) {
+		int victim = -1, most = 0;
+		for (int i=0; i<b->nthreads; i++) {
+			if (i == id) continue;
+			mutex_lock(&b->range[i].lock);
+			int left = b->range[i].hi - b->range[i].lo;
+			mutex_unlock(&b->range[i].lock);
+			if (left > most) {
+				most = left;
+				victim = i;
+			}
+		}
+		if (victim < 0) return -1;
+		BatchRange *v = &b->range[victim];
+		int lo = 0, hi = 0;
+		mutex_lock(&v->lock);
+		if (v->lo < v->hi) {
+			lo = v->lo + (v->hi - v->lo) / 2;
+			hi = v->hi;
+			v->hi = lo;
+		}
+		mutex_unlock(&v->lock);
+		if (lo == hi) continue; /* drained meanwhile, look again */
+		mutex_lock(&own->lock);
+		own->lo = lo + 1;
+		own->hi = hi;
+		mutex_unlock(&own->lock);
+		(*steals)++;
+		j = lo;
+	}
+	return j;
+}
+
+static void batch_job(BatchWorker *w, Grid *g, int j) {
+	const Batch *b = w->b;
+	unsigned long long x = b->seed ^ (unsigned long long)j * 0xD1B54A32D192ED03ull;
+	rng_seed(splitmix64(&x));
+	double t0 = now_ms();
+	run_generator(b->gen, g);
+	double t1 = now_ms();
+	solve(b->algo, g, 1, 1, b->rows-2, b->cols-2, -1);
+	w->gen_ms += t1 - t0;
+	w->solve_ms += now_ms() - t1;
+	int n = g->n, start = grid_index(g, 1, 1), path = 0;
+	for (int i=0; i<n; i++) {
+		if (g->marks[i] & M_VISIT) w->expanded++;
+		if (g->marks[i] & M_PATH) {
+			path++;
+			if (i != start) w->cost += cell_cost(g->cells[i]);
+		}
+	}
+	w->path += path;
+	w->solved += path > 0;
+	w->jobs++;
+}
+
+static void *batch_worker(void *arg) {
+	BatchWorker *w = arg;
+	Grid g;
+	grid_init(&g, w->b->rows, w->b->cols);
+	for (int j; (j = batch_next(w->b, w->id, &w->steals)) >= 0; ) batch_job(w, &g, j);
+	grid_free(&g);
+	solver_caches_free();
+	if (w->id) { /* worker 0 is the calling thread, its counts are already in place */
+		w->allocs = alloc_count;
+		w->alloc_bytes = alloc_bytes;
+#ifndef MAZE_NO_STATS
+		w->stats = stats;
+#endif
+	}
+	return NULL;
+}
+
+static void run_batch(int jobs, int rows, int cols, int gen, int algo, int nthreads, unsigned long long seed) {
+	Batch b;
+	BatchWorker w[MAX_THREADS];
+	thread_t tid[MAX_THREADS];
+	if (nthreads < 1) nthreads = 1;
+	if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+	if (jobs < 1) jobs = 1;
+	b.rows = rows;
+	b.cols = cols;
+	b.gen = gen;
+	b.algo = algo;
+	b.nthreads = nthreads;
+	b.seed = seed;
+	for (int i=0; i<nthreads; i++) {
+		mutex_init(&b.range[i].lock);
+		b.range[i].lo = (int)((long long)jobs * i / nthreads);
+		b.range[i].hi = (int)((long long)jobs * (i+1) / nthreads);
+		memset(&w[i], 0, sizeof w[i]);
+		w[i].b = &b;
+		w[i].id = i;
+	}
+	int saved_threads = alt_threads;
+	alt_threads = 1; /* the pool already uses every core */
+	double t0 = now_ms();
+	for (int i=1; i<nthreads; i++) thread_start(&tid[i], batch_worker, &w[i]);
+	batch_worker(&w[0]);
+	for (int i=1; i<nthreads; i++) thread_join(tid[i]);
+	double wall = now_ms() - t0;
+	alt_threads = saved_threads;
+
+	BatchWorker sum;
+	memset(&sum, 0, sizeof sum);
+	for (int i=0; i<nthreads; i++) {
+		mutex_destroy(&b.range[i].lock);
+		sum.jobs += w[i].jobs;
+		sum.steals += w[i].steals;
+		sum.solved += w[i].solved;
+		sum.expanded += w[i].expanded;
+		sum.path += w[i].path;
+		sum.cost += w[i].cost;
+		sum.gen_ms += w[i].gen_ms;
+		sum.solve_ms += w[i].solve_ms;
+		alloc_count += w[i].allocs;
+		alloc_bytes += w[i].alloc_bytes;
+#ifndef MAZE_NO_STATS
+		if (i) stats_merge(&stats, &w[i].stats);
+#endif
+	}
+	printf("batch: %ld jobs, %s %dx%d, %s, seed %llu, %d threads\n", sum.jobs, gen_names[gen], cols, rows,
+	       algo_names[algo], seed, nthreads);
+	printf("solved %ld, unreachable %ld, mean path %.1f, mean expanded %.1f, total cost %llu\n", sum.solved,
+	       sum.jobs - sum.solved, sum.solved ? (double)sum.path / sum.solved : 0.0, (double)sum.expanded / sum.jobs, sum.cost);
+	printf("generate %.3f ms, solve %.3f ms per job; %.2f ms wall, %.1f jobs/s, %ld steals\n", sum.gen_ms / sum.jobs,
+	       sum.solve_ms / sum.jobs, wall, wall > 0 ? sum.jobs * 1000.0 / wall : 0.0, sum.steals);
+	printf("jobs per thread:");
+	for (int i=0; i<nthreads; i++) printf(" %ld", w[i].jobs);
+	printf("\n");
+}
+
+/* solver service: --serve SOCKET listens on a Unix domain socket (--serve -
+   reads stdin and answers on stdout) and answers every request line with
+   one line, keeping grids, solver tables and scratch memory warm between
+   requests:
+     gen SLOT ROWS COLS GEN SEED         -> ok ROWS COLS
+     load SLOT FILE                      -> ok ROWS COLS
+     solve SLOT ALGO SR SC ER EC [path]  -> ok PATH COST EXPANDED US [r,c ...]
+     query SLOT SR SC ER EC              -> ok COST US
+     multi SLOT any|all SOURCES TARGETS [path]
+                                         -> ok REACHED US STEPS... [| r,c ...]
+     drop SLOT | stats | quit | shutdown
+   query runs HPA* (near-optimal, COST -1 if unreachable). multi takes its
+   cells as R,C;R,C;..., sweeps BFS from all sources at once towards the
+   targets and gives the steps to each target (-1 if not reached) and, with
+   path, each target's path from its nearest source. Failures answer
+   "err MESSAGE". One thread serves all clients in turn, so requests never
+   run concurrently. --loadgen SOCKET drives a server with --threads
+   clients and reports requests/s and latency percentiles. */
+#define SERVE_SLOTS 64
+#define SERVE_CLIENTS 64
+#define SERVE_LINE 4096
+#define SERVE_POINTS 256 /* sources or targets in one multi request */
+#define SERVE_MAX_CELLS (1 << 26)
+
+typedef struct {
+	Grid g;
+	int used;
+	/* solver tables: the library caches them per thread for one grid at a
+	   time, so each slot keeps its own and swaps them in while served */
+	JumpTable jps;
+	Landmarks *alt;
+	Hpa *hpa;
+} ServeSlot;
+
+static ServeSlot slots[SERVE_SLOTS];
+static long long serve_requests, serve_errors;
+
+typedef struct {
+	char *s;
+	size_t len, cap;
+} Reply;
+
+static void reply_printf(Reply *r, const char *fmt, ...) {
+	va_list ap;
+	for (;;) {
+		va_start(ap, fmt);
+		int n = vsnprintf(r->s + r->len, r->cap - r->len, fmt, ap);
+		va_end(ap);
+		if (n < 0) return;
+		if ((size_t)n < r->cap - r->len) {
+			r->len += n;
+			return;
+		}
+		r->cap = r->cap*2 + n + 1;
+		r->s = xrealloc(r->s, r->cap);
+	}
+}
+
+/* path cells in order from the goal, collected by a solve's observer */
+typedef struct {
+	Reply *r;
+	int cols;
+} PathOut;
+
+static void serve_path_cell(void *ctx, const Grid *g, int cell, int before) {
+	PathOut *p = ctx;
+	(void)g;
+	if (!(before & M_PATH)) reply_printf(p->r, " %d,%d", cell / p->cols, cell % p->cols);
+}
+
+/* "r,c;r,c;..." -> row-major cells; returns the count, -1 if malformed or
+   outside the grid */
+static int parse_cells(const char *s, const Grid *g, int *out, int max) {
+	int n = 0;
+	for (;;) {
+		char *end;
+		long r = strtol(s, &end, 10), c;
+		if (end == s || *end != ',') return -1;
+		s = end + 1;
+		c = strtol(s, &end, 10);
+		if (end == s || n == max || !is_inside(g, (int)r, (int)c)) return -1;
+		out[n++] = (int)r * g->cols + (int)c;
+		if (!*end) return n;
+		if (*end != ';') return -1;
+		s = end + 1;
+	}
+}
+
+static ServeSlot *serve_slot(const char *arg, Reply *r) {
+	int i = atoi(arg);
+	if (i < 0 || i >= SERVE_SLOTS || !slots[i].used) {
+		reply_printf(r, "err no grid in slot %s", arg);
+		return NULL;
+	}
+	return &slots[i];
+}
+
+static void slot_tables_swap(ServeSlot *s) {
+	JumpTable j = jps_cache;
+	Landmarks *l = alt_cache;
+	Hpa *h = hpa_cache;
+	jps_cache = s->jps;
+	alt_cache = s->alt;
+	hpa_cache = s->hpa;
+	s->jps = j;
+	s->alt = l;
+	s->hpa = h;
+}
+
+static void serve_drop(ServeSlot *s) {
+	if (!s->used) return;
+	grid_free(&s->g);
+	free(s->jps.jd);
+	if (s->alt) landmarks_free(s->alt);
+	if (s->hpa) hpa_free(s->hpa);
+	memset(s, 0, sizeof *s);
+}
+
+static void serve_release(void) {
+	for (int i=0; i<SERVE_SLOTS; i++) serve_drop(&slots[i]);
+	solver_caches_free();
+}
+
+/* answers one request into r; returns 1 to close the connection, 2 to stop */
+static int serve_request(char *line, Reply *r) {
+	char *arg[9];
+	int n = 0;
+	for (char *p = strtok(line, " \t\r\n"); p && n < 9; p = strtok(NULL, " \t\r\n")) arg[n++] = p;
+	serve_requests++;
+	r->len = 0;
+	double t0 = now_ms();
+	if (!n) reply_printf(r, "err empty request");
+	else if (!strcmp(arg[0], "gen") && n == 6) {
+		int i = atoi(arg[1]), rows = odd_at_least_11(atoi(arg[2])), cols = odd_at_least_11(atoi(arg[3]));
+		int gen = maze_gen_find(arg[4]);
+		if (gen < 0 && isdigit((unsigned char)arg[4][0])) gen = atoi(arg[4]);
+		if (i < 0 || i >= SERVE_SLOTS) reply_printf(r, "err bad slot");
+		else if (gen < 0 || gen >= GEN_COUNT) reply_printf(r, "err unknown generator %s", arg[4]);
+		else if ((long long)rows * cols > SERVE_MAX_CELLS) reply_printf(r, "err grid too large");
+		else {
+			ServeSlot *s = &slots[i];
+			/* a warm grid of the same size is regenerated in place */
+			if (s->used && (s->g.map || s->g.rows != rows || s->g.cols != cols)) serve_drop(s);
+			if (!s->used) grid_init(&s->g, rows, cols);
+			s->used = 1;
+			rng_seed(strtoull(arg[5], NULL, 10));
+			run_generator(gen, &s->g);
+			scratch_reset();
+			reply_printf(r, "ok %d %d", rows, cols);
+		}
+	} else if (!strcmp(arg[0], "load") && n == 3) {
+		int i = atoi(arg[1]);
+		Grid g;
+		MazeInfo info;
+		const char *err = i < 0 || i >= SERVE_SLOTS ? "bad slot" : maze_load(arg[2], &g, &info, 0);
+		if (err) reply_printf(r, "err %s", err);
+		else {
+			serve_drop(&slots[i]);
+			slots[i].g = g;
+			slots[i].used = 1;
+			reply_printf(r, "ok %d %d", g.rows, g.cols);
+		}
+	} else if (!strcmp(arg[0], "solve") && (n == 7 || (n == 8 && !strcmp(arg[7], "path")))) {
+		ServeSlot *s = serve_slot(arg[1], r);
+		int algo = maze_algo_find(arg[2]), sr = atoi(arg[3]), sc = atoi(arg[4]), er = atoi(arg[5]), ec = atoi(arg[6]);
+		if (algo < 0) algo = atoi(arg[2]);
+		if (!s) ;
+		else if (algo < 1 || algo > ALGO_COUNT) reply_printf(r, "err unknown algorithm %s", arg[2]);
+		else if (!is_inside(&s->g, sr, sc) || !is_inside(&s->g, er, ec)) reply_printf(r, "err outside the grid");
+		else {
+			Grid *g = &s->g;
+			Reply cells = { NULL, 0, 0 };
+			PathOut po = { &cells, g->cols };
+			MazeObserver obs = { NULL, NULL, serve_path_cell, NULL, &po };
+			slot_tables_swap(s);
+			long path = run_solver(algo, g, sr, sc, er, ec, n == 8 ? &obs : NULL);
+			slot_tables_swap(s);
+			long long cost = 0, expanded = 0;
+			int start = grid_index(g, sr, sc);
+			for (int u=0; u<g->n; u++) {
+				expanded += (g->marks[u] & M_VISIT) != 0;
+				if ((g->marks[u] & M_PATH) && u != start) cost += cell_cost(g->cells[u]);
+			}
+			reply_printf(r, "ok %ld %lld %lld %.0f", path, path ? cost : -1, expanded, (now_ms() - t0) * 1000);
+			if (cells.len) reply_printf(r, "%s", cells.s);
+			free(cells.s);
+		}
+	} else if (!strcmp(arg[0], "query") && n == 6) {
+		ServeSlot *s = serve_slot(arg[1], r);
+		int sr = atoi(arg[2]), sc = atoi(arg[3]), er = atoi(arg[4]), ec = atoi(arg[5]);
+		if (!s) ;
+		else if (!is_inside(&s->g, sr, sc) || !is_inside(&s->g, er, ec)) reply_printf(r, "err outside the grid");
+		else if (cell_is_wall(grid_get(&s->g, sr, sc)) || cell_is_wall(grid_get(&s->g, er, ec))) reply_printf(r, "ok -1 0");
+		else {
+			slot_tables_swap(s);
+			int cost = hpa_query(hpa_cached(&s->g), grid_index(&s->g, sr, sc), grid_index(&s->g, er, ec), NULL);
+			slot_tables_swap(s);
+			scratch_reset();
+			reply_printf(r, "ok %d %.0f", cost < LPA_INF ? cost : -1, (now_ms() - t0) * 1000);
+		}
+	} else if (!strcmp(arg[0], "multi") && (n == 5 || (n == 6 && !strcmp(arg[5], "path")))) {
+		ServeSlot *s = serve_slot(arg[1], r);
+		int src[SERVE_POINTS], tgt[SERVE_POINTS], ns = -1, nt = -1;
+		int stop = !strcmp(arg[2], "any") ? MAZE_STOP_ANY : !strcmp(arg[2], "all") ? MAZE_STOP_ALL : -1;
+		if (s) {
+			ns = parse_cells(arg[3], &s->g, src, SERVE_POINTS);
+			nt = parse_cells(arg[4], &s->g, tgt, SERVE_POINTS);
+		}
+		if (!s) ;
+		else if (stop < 0) reply_printf(r, "err expected any or all, got %s", arg[2]);
+		else if (ns < 0 || nt < 0) reply_printf(r, "err bad cell list");
+		else {
+			MazeMulti *m = maze_search_multi(&s->g, src, ns, tgt, nt, stop, NULL);
+			reply_printf(r, "ok %d %.0f", maze_multi_reached(m), (now_ms() - t0) * 1000);
+			for (int i=0; i<nt; i++) reply_printf(r, " %ld", maze_multi_path(m, tgt[i], NULL, 0));
+			int *path = NULL;
+			long cap = 0;
+			for (int i=0; i<nt && n == 6; i++) {
+				long steps = maze_multi_path(m, tgt[i], path, cap);
+				if (steps >= cap) {
+					cap = steps + 1;
+					path = xrealloc(path, sizeof(int) * cap);
+					maze_multi_path(m, tgt[i], path, cap);
+				}
+				reply_printf(r, " |");
+				for (long j=0; j<=steps; j++) reply_printf(r, " %d,%d", path[j] / s->g.cols, path[j] % s->g.cols);
+			}
+			free(path);
+			maze_multi_free(m);
+		}
+	} else if (!strcmp(arg[0], "drop") && n == 2) {
+		ServeSlot *s = serve_slot(arg[1], r);
+		if (s) {
+			serve_drop(s);
+			reply_printf(r, "ok");
+		}
+	} else if (!strcmp(arg[0], "stats") && n == 1) {
+		int used = 0;
+		for (int i=0; i<SERVE_SLOTS; i++) used += slots[i].used;
+		reply_printf(r, "ok %lld requests, %lld errors, %d grids, %.1f MB allocated", serve_requests, serve_errors,
+		             used, alloc_bytes / 1048576.0);
+	} else if (!strcmp(arg[0], "quit") && n == 1) {
+		reply_printf(r, "ok");
+		return 1;
+	} else if (!strcmp(arg[0], "shutdown") && n == 1) {
+		reply_printf(r, "ok");
+		return 2;
+	} else reply_printf(r, "err bad request %s", arg[0]);
+	if (r->len >= 3 && !memcmp(r->s, "err", 3)) serve_errors++;
+	return 0;
+}
+
+static int serve_stdio(void) {
+	char line[SERVE_LINE];
+	Reply r = { NULL, 0, 0 };
+	int done = 0;
+	while (!done && fgets(line, sizeof line, stdin)) {
+		done = serve_request(line, &r);
+		fwrite(r.s, 1, r.len, stdout);
+		putchar('\n');
+		fflush(stdout);
+	}
+	free(r.s);
+	serve_release();
+	return 0;
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+static int run_server(const char *path) {
+	if (!strcmp(path, "-")) return serve_stdio();
+	fprintf(stderr, "%s: Unix domain sockets are not supported here, use --serve -\n", path);
+	return 1;
+}
+static int run_loadgen(const char *path, int clients, long requests, int rows, int cols, int gen, int algo, unsigned seed) {
+	(void)clients; (void)requests; (void)rows; (void)cols; (void)gen; (void)algo; (void)seed;
+	fprintf(stderr, "%s: Unix domain sockets are not supported here\n", path);
+	return 1;
+}
+#else
+static int write_all(int fd, const char *p, size_t n) {
+	while (n) {
+		ssize_t k = write(fd, p, n);
+		if (k <= 0) return -1;
+		p += k;
+		n -= k;
+	}
+	return 0;
+}
+
+static int unix_address(struct sockaddr_un *a, const char *path) {
+	memset(a, 0, sizeof *a);
+	a->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof a->sun_path) return -1;
+	strcpy(a->sun_path, path);
+	return 0;
+}
+
+typedef struct {
+	int fd;
+	int len;
+	char buf[SERVE_LINE];
+} ServeClient;
+
+static int run_server(const char *path) {
+	if (!strcmp(path, "-")) return serve_stdio();
+	struct sockaddr_un addr;
+	int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (lfd < 0 || unix_address(&addr, path)) {
+		fprintf(stderr, "%s: cannot create socket\n", path);
+		return 1;
+	}
+	unlink(path); /* a stale socket from an earlier run */
+	if (bind(lfd, (struct sockaddr*)&addr, sizeof addr) || listen(lfd, SERVE_CLIENTS)) {
+		fprintf(stderr, "%s: cannot listen\n", path);
+		close(lfd);
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN); /* a client that went away only loses its reply */
+	fprintf(stderr, "serving on %s\n", path);
+	ServeClient *cl = xcalloc(SERVE_CLIENTS, sizeof(ServeClient));
+	int ncl = 0, stop = 0;
+	Reply r = { NULL, 0, 0 };
+	while (!stop) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		int maxfd = lfd;
+		if (ncl < SERVE_CLIENTS) FD_SET(lfd, &fds);
+		for (int i=0; i<ncl; i++) {
+			FD_SET(cl[i].fd, &fds);
+			if (cl[i].fd > maxfd) maxfd = cl[i].fd;
+		}
+		if (select(maxfd+1, &fds, NULL, NULL, NULL) < 0) continue;
+		if (FD_ISSET(lfd, &fds)) {
+			int fd = accept(lfd, NULL, NULL);
+			if (fd >= 0) {
+				cl[ncl].fd = fd;
+				cl[ncl++].len = 0;
+			}
+		}
+		for (int i=0; i<ncl && !stop; i++) {
+			ServeClient *c = &cl[i];
+			if (!FD_ISSET(c->fd, &fds)) continue;
+			ssize_t k = read(c->fd, c->buf + c->len, SERVE_LINE - 1 - c->len);
+			int closing = k <= 0;
+			if (k > 0) c->len += (int)k;
+			/* answer every complete line; a line that can't fit is an error */
+			char *p = c->buf, *nl;
+			while (!closing && !stop && (nl = memchr(p, '\n', c->len - (p - c->buf)))) {
+				*nl = 0;
+				int done = serve_request(p, &r);
+				reply_printf(&r, "\n");
+				closing = write_all(c->fd, r.s, r.len) || done == 1;
+				stop = done == 2;
+				p = nl + 1;
+			}
+			c->len -= (int)(p - c->buf);
+			memmove(c->buf, p, c->len);
+			if (c->len == SERVE_LINE - 1) {
+				write_all(c->fd, "err request too long\n", 21);
+				closing = 1;
+			}
+			if (closing) {
+				close(c->fd);
+				cl[i--] = cl[--ncl];
+			}
+		}
+	}
+	for (int i=0; i<ncl; i++) close(cl[i].fd);
+	close(lfd);
+	unlink(path);
+	free(cl);
+	free(r.s);
+	serve_release();
+	return 0;
+}
+
+/* load generator: each client thread warms its own slot with one gen, then
+   runs a closed loop of solves between random odd cells (always open in
+   perfect mazes), timing each request to its reply */
+typedef struct {
+	const char *path;
+	int id, rows, cols, gen, algo;
+	unsigned seed;
+	long requests, errors;
+	double *lat_ms;
+} LoadClient;
+
+static int client_call(int fd, const char *req, char *reply, size_t cap) {
+	if (write_all(fd, req, strlen(req))) return -1;
+	size_t len = 0;
+	while (len == 0 || reply[len-1] != '\n') {
+		if (len + 1 >= cap) return -1;
+		ssize_t k = read(fd, reply + len, cap - 1 - len);
+		if (k <= 0) return -1;
+		len += k;
+	}
+	reply[len] = 0;
+	return memcmp(reply, "ok", 2) ? 1 : 0;
+}
+
+static void *load_client(void *arg) {
+	LoadClient *lc = arg;
+	struct sockaddr_un addr;
+	char req[SERVE_LINE], reply[SERVE_LINE];
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || unix_address(&addr, lc->path) || connect(fd, (struct sockaddr*)&addr, sizeof addr)) {
+		lc->errors = lc->requests;
+		lc->requests = 0;
+		if (fd >= 0) close(fd);
+		return NULL;
+	}
+	snprintf(req, sizeof req, "gen %d %d %d %d %u\n", lc->id, lc->rows, lc->cols, lc->gen, lc->seed + lc->id);
+	if (client_call(fd, req, reply, sizeof reply)) {
+		lc->errors = lc->requests;
+		lc->requests = 0;
+		close(fd);
+		return NULL;
+	}
+	unsigned long long x = lc->seed ^ (unsigned long long)(lc->id + 1) * 0xD1B54A32D192ED03ull;
+	int hr = (lc->rows - 1) / 2, hc = (lc->cols - 1) / 2;
+	for (long i=0; i<lc->requests; i++) {
+		int sr = 1 + 2*(int)(splitmix64(&x) % hr), sc = 1 + 2*(int)(splitmix64(&x) % hc);
+		int er = 1 + 2*(int)(splitmix64(&x) % hr), ec = 1 + 2*(int)(splitmix64(&x) % hc);
+		snprintf(req, sizeof req, "solve %d %d %d %d %d %d\n", lc->id, lc->algo, sr, sc, er, ec);
+		double t0 = now_ms();
+		int rc = client_call(fd, req, reply, sizeof reply);
+		lc->lat_ms[i] = now_ms() - t0;
+		if (rc < 0) {
+			lc->errors += lc->requests - i;
+			lc->requests = i;
+			break;
+		}
+		lc->errors += rc;
+	}
+	close(fd);
+	return NULL;
+}
+
+static int run_loadgen(const char *path, int clients, long requests, int rows, int cols, int gen, int algo, unsigned seed) {
+	LoadClient lc[MAX_THREADS];
+	thread_t tid[MAX_THREADS];
+	if (clients < 1) clients = 1;
+	if (clients > MAX_THREADS) clients = MAX_THREADS;
+	if (requests < clients) requests = clients;
+	double *lat = xmalloc(sizeof(double) * requests);
+	for (int i=0; i<clients; i++) {
+		long lo = requests * i / clients, hi = requests * (i+1) / clients;
+		lc[i] = (LoadClient){ path, i, rows, cols, gen, algo, seed, hi - lo, 0, lat + lo };
+	}
+	double t0 = now_ms();
+	for (int i=0; i<clients; i++) thread_start(&tid[i], load_client, &lc[i]);
+	for (int i=0; i<clients; i++) thread_join(tid[i]);
+	double wall = now_ms() - t0;
+
+	long done = 0, errors = 0;
+	for (int i=0; i<clients; i++) {
+		memmove(lat + done, lc[i].lat_ms, sizeof(double) * lc[i].requests); /* compact: failed clients leave gaps */
+		done += lc[i].requests;
+		errors += lc[i].errors;
+	}
+	printf("loadgen: %d clients, %ld solves on %s %dx%d with %s, %ld errors\n", clients, done, gen_names[gen], cols, rows,
+	       algo_names[algo], errors);
+	if (done) {
+		qsort(lat, done, sizeof(double), cmp_double);
+		printf("%.1f requests/s, latency p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", done * 1000.0 / wall,
+		       lat[(done * 50 + 99) / 100 - 1], lat[(done * 99 + 99) / 100 - 1], lat[done-1]);
+	}
+	free(lat);
+	return errors ? 1 : 0;
+}
+#endif
+
+/* interactive wall editor: the path is repaired by LPA* after every toggle */
+static void edit_walls(Grid *g, int sr, int sc, int er, int ec) {
+	Lpa *l = lpa_create(g, sr, sc, er, ec);
+	int r = sr, c = sc, key = 0;
+	lpa_compute(l);
+	overview_drop();
+	raw_mode(1);
+	clear_screen();
+	view.follow = 1;
+	while (key != 'q' && key != 'Q') {
+		view_focus = grid_index(g, r, c);
+		mark_or(g, r, c, M_CURSOR);
+		draw_grid(g, sr, sc, er, ec);
+		mark_andnot(g, r, c, M_CURSOR);
+		if (l->gv[l->t] < LPA_INF) printf("\nPath cost %d, repair expanded %ld cells   ", l->gv[l->t], l->expanded);
+		else printf("\nNo path, repair expanded %ld cells        ", l->expanded);
+		printf("\n[arrows/wasd] Move  [space] Toggle wall  [q] Done\n");
+		fflush(stdout);
+		key = read_key();
+		if ((key == KEY_UP || key == 'w') && r > 0) r--;
+		else if ((key == KEY_DOWN || key == 's') && r < g->rows-1) r++;
+		else if ((key == KEY_LEFT || key == 'a') && c > 0) c--;
+		else if ((key == KEY_RIGHT || key == 'd') && c < g->cols-1) c++;
+		else if (key == ' ') {
+			int u = grid_index(g, r, c);
+			lpa_toggle(l, &u, 1);
+			lpa_compute(l);
+			overview_drop();
+		}
+	}
+	raw_mode(0);
+	lpa_free(l);
+}
+
+static void pan_view(const Grid *g, int sr, int sc, int er, int ec) {
+	int key = 0;
+	raw_mode(1);
+	while (key != 'q' && key != 'Q' && key != '\n') {
+		view_pan(key);
+		draw_grid(g, sr, sc, er, ec);
+		printf("\nRows %d-%d, columns %d-%d of %dx%d, %s%s\n", view.top, view.top + view.h - 1, view.left,
+		       view.left + view.w - 1, g->cols, g->rows, render_names[view.mode], view.follow ? ", following" : "");
+		printf("[arrows/hjkl] Pan  [f] Follow solver  [m] Render mode  [q] Done\n");
+		fflush(stdout);
+		key = read_key();
+	}
+	raw_mode(0);
+}
+
+/* trace replay: seeks through the key index, then plays events through the
+   renderer (every `every` events, delay_ms apart; negative = no drawing)
+   and prints summary statistics. Returns 0 on success. */
+static unsigned long long read_varint(const unsigned char **p, const unsigned char *end) {
+	unsigned long long v = 0;
+	for (int shift = 0; *p < end && shift < 64; shift += 7) {
+		unsigned char b = *(*p)++;
+		v |= (unsigned long long)(b & 0x7F) << shift;
+		if (!(b & 0x80)) break;
+	}
+	return v;
+}
+
+/* applies an EV_KEY payload (after the tag) to marks, returns its event number */
+static long long replay_key(const unsigned char **p, const unsigned char *end, Grid *g, int *last) {
+	long long at = (long long)read_varint(p, end);
+	*last = (int)read_varint(p, end);
+	size_t n = (size_t)g->rows * g->cols;
+	for (size_t i=0; i<n && *p < end; ) {
+		size_t run = read_varint(p, end);
+		mark_t m = *(*p)++;
+		if (run > n - i) run = n - i;
+#ifdef MAZE_TILED
+		for (size_t j=0; j<run; j++) g->marks[grid_at(g, (int)(i+j))] = m;
+#else
+		memset(g->marks + i, m, run);
+#endif
+		i += run;
+	}
+	overview_drop();
+	return at;
+}
+
+static int replay_trace(const char *path, long long seek, int every, int delay_ms) {
+	unsigned char *data;
+	size_t len;
+	if (map_file(path, &data, &len)) {
+		fprintf(stderr, "%s: cannot open\n", path);
+		return -1;
+	}
+	const unsigned char *end = data + len;
+	if (len < TRACE_HEADER + 12 || memcmp(data, "MTRC", 4) || get_le(data+4, 2) != TRACE_VERSION ||
+	    memcmp(end - 4, "MTRE", 4)) {
+		fprintf(stderr, "%s: not a trace file\n", path);
+		unmap_file(data, len);
+		return -1;
+	}
+	/* everything the header and index point at must lie inside the file:
+	   cells, then events up to the key index, which fills the rest */
+	unsigned long long f[8];
+	for (int i=0; i<8; i++) f[i] = get_le(data + 8 + 4*i, 4);
+	unsigned long long rows = f[0], cols = f[1], n = rows * cols, body = 0, index_at = 0, nkeys = 0;
+	int bad = rows < 3 || cols < 3 || n > INT_MAX || f[2] >= rows || f[3] >= cols || f[4] >= rows || f[5] >= cols;
+	if (!bad) {
+		body = cells_packed_size(n, f[7] & MF_COSTS);
+		index_at = get_le(end - 12, 8);
+		bad = body > len - 12 - TRACE_HEADER || index_at < TRACE_HEADER + body || index_at > len - 16;
+	}
+	if (!bad) {
+		nkeys = get_le(data + index_at, 4);
+		bad = (len - 16 - index_at) % 16 || nkeys != (len - 16 - index_at) / 16;
+	}
+	for (unsigned long long k=0; !bad && k<nkeys; k++) {
+		unsigned long long at = get_le(data + index_at + 4 + 16*k + 8, 8);
+		bad = at < TRACE_HEADER + body || at >= index_at;
+	}
+	if (bad) {
+		fprintf(stderr, "%s: corrupt trace\n", path);
+		unmap_file(data, len);
+		return -1;
+	}
+	Grid g;
+	grid_init(&g, (int)rows, (int)cols);
+	int sr = (int)f[2], sc = (int)f[3], er = (int)f[4], ec = (int)f[5];
+	cell_t *cells = xmalloc(n);
+	cells_unpack(data + TRACE_HEADER, n, f[7] & MF_COSTS, cells);
+	cells_from_rows(&g, cells);
+	free(cells);
+	const unsigned char *p = data + TRACE_HEADER + body;
+	const unsigned char *ev_end = data + index_at;
+
+	/* seek: restore the last keyframe at or before the target event */
+	long long events = 0, counts[3] = {0}, frontier = 0, max_frontier = 0;
+	int last = 0;
+	for (int k = (int)nkeys-1; k >= 0; k--) {
+		long long at = (long long)get_le(ev_end + 4 + 16*k, 8);
+		if (at <= seek) {
+			p = data + get_le(ev_end + 4 + 16*k + 8, 8);
+			read_varint(&p, ev_end);
+			events = replay_key(&p, ev_end, &g, &last);
+			break;
+		}
+	}
+	for (int i=0; i<g.n; i++) frontier += (g.marks[i] & M_FRONT) != 0;
+	double t0 = now_ms();
+	while (p < ev_end) {
+		unsigned long long v = read_varint(&p, ev_end);
+		int ev = (int)(v & 3);
+		if (ev == EV_KEY) {
+			int dummy;
+			replay_key(&p, ev_end, &g, &dummy);
+			continue;
+		}
+		unsigned long long zz = v >> 2;
+		long long d = zz & 1 ? -(long long)((zz + 1) >> 1) : (long long)(zz >> 1);
+		if (last + d < 0 || (unsigned long long)(last + d) >= n) {
+			bad = 1;
+			break;
+		}
+		last += (int)d;
+		int u = grid_at(&g, last);
+		mark_t before = g.marks[u];
+		g.marks[u] = mark_event(before, ev);
+		note_mark(&g, u, ev, before);
+		frontier += ((g.marks[u] & M_FRONT) != 0) - ((before & M_FRONT) != 0);
+		if (frontier > max_frontier) max_frontier = frontier;
+		counts[ev]++;
+		if (++events > seek && delay_ms >= 0 && events % every == 0) {
+			for (int key; (key = poll_key()); ) view_pan(key);
+			draw_grid(&g, sr, sc, er, ec);
+			printf("\nevent %lld\n", events);
+			stats_sleep(delay_ms);
+		}
+	}
+	if (bad) {
+		fprintf(stderr, "%s: corrupt trace\n", path);
+		grid_free(&g);
+		unmap_file(data, len);
+		return -1;
+	}
+	if (delay_ms >= 0) draw_grid(&g, sr, sc, er, ec);
+	double ms = now_ms() - t0;
+	printf("\n%s: %dx%d, %lld events (%lld frontier, %lld visit, %lld path) after seek to %lld\n",
+	       path, g.cols, g.rows, events, counts[EV_FRONT], counts[EV_VISIT], counts[EV_PATH], seek);
+	printf("max frontier %lld, %llu keyframes, %zu bytes (%.2f bytes/event), replayed in %.2f ms\n",
+	       max_frontier, nkeys, len, events ? (double)(index_at - TRACE_HEADER) / events : 0.0, ms);
+	grid_free(&g);
+	unmap_file(data, len);
+	return 0;
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [--bench] [--rows N] [--cols N] [--gen maze|terrain|rooms] [--seed S] [--threads N]\n"
+	        "       [--load FILE [--verify]] [--save FILE [--pack]]\n"
+	        "       [--export FILE.png|FILE.ppm [--scale PX] [--algo N|NAME]]\n"
+	        "       [--record FILE.gif|frame_%%05d.ppm [--every K] [--scale PX] [--algo N|NAME]]\n"
+	        "       [--trace FILE [--algo N|NAME]] [--replay FILE [--seek N] [--every K] [--delay MS | --summary]]\n"
+	        "       [--render block|half|braille|overview] [--stats] [--stats-json FILE|-]\n"
+	        "       [--suite [--sizes N,N,...] [--seeds K] [--reps N] [--warmup N] [--json FILE|-] [--baseline FILE]]\n"
+	        "       [--batch JOBS [--rows N] [--cols N] [--gen NAME] [--algo N|NAME] [--threads N] [--seed S]]\n"
+	        "       [--serve SOCKET|-] [--loadgen SOCKET [--requests N] [--threads CLIENTS] [--rows N] [--cols N] [--gen NAME] [--algo N]]\n",
+	        prog);
+}
+/* an unknown --algo, --gen or --render name */
+static int unknown_name(const char *prog, const char *what, const char *name) {
+	fprintf(stderr, "%s: unknown %s '%s'\n", prog, what, name);
+	usage(prog);
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	int bench = 0, rows = 0, cols = 0, gen = 0, pack = 0, verify = 0, scale = 4, algo = 2, every = 50;
+	int replay_delay = 10, suite = 0, seed_set = 0, nsizes = 0, nseeds = 1, reps = 5, warmup = 1, batch = 0;
+	long requests = 10000;
+	int sizes[SUITE_MAX_SIZES];
+	long long seek = 0;
+	const char *load_path = NULL, *save_path = NULL, *export_path = NULL, *record_path = NULL;
+	const char *trace_path = NULL, *replay_path = NULL, *json_path = NULL, *baseline_path = NULL;
+	const char *serve_path = NULL, *loadgen_path = NULL;
+	alt_threads = cpu_count();
+	unsigned seed = (unsigned)time(NULL);
+	for (int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "--bench")) bench = 1;
+		else if (!strcmp(argv[i], "--suite")) suite = 1;
+		else if (!strcmp(argv[i], "--batch") && i+1 < argc) batch = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--serve") && i+1 < argc) serve_path = argv[++i];
+		else if (!strcmp(argv[i], "--loadgen") && i+1 < argc) loadgen_path = argv[++i];
+		else if (!strcmp(argv[i], "--requests") && i+1 < argc) requests = atol(argv[++i]);
+		else if (!strcmp(argv[i], "--sizes") && i+1 < argc) {
+			char *p = argv[++i];
+			for (nsizes = 0; *p && nsizes < SUITE_MAX_SIZES; p += *p == ',') sizes[nsizes++] = (int)strtol(p, &p, 10);
+		}
+		else if (!strcmp(argv[i], "--seeds") && i+1 < argc) nseeds = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--reps") && i+1 < argc) reps = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--warmup") && i+1 < argc) warmup = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--json") && i+1 < argc) json_path = argv[++i];
+		else if (!strcmp(argv[i], "--baseline") && i+1 < argc) baseline_path = argv[++i];
+		else if (!strcmp(argv[i], "--pack")) pack = 1;
+		else if (!strcmp(argv[i], "--verify")) verify = 1;
+		else if (!strcmp(argv[i], "--load") && i+1 < argc) load_path = argv[++i];
+		else if (!strcmp(argv[i], "--save") && i+1 < argc) save_path = argv[++i];
+		else if (!strcmp(argv[i], "--export") && i+1 < argc) export_path = argv[++i];
+		else if (!strcmp(argv[i], "--scale") && i+1 < argc) scale = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--record") && i+1 < argc) record_path = argv[++i];
+		else if (!strcmp(argv[i], "--every") && i+1 < argc) every = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--trace") && i+1 < argc) trace_path = argv[++i];
+		else if (!strcmp(argv[i], "--replay") && i+1 < argc) replay_path = argv[++i];
+		else if (!strcmp(argv[i], "--seek") && i+1 < argc) seek = atoll(argv[++i]);
+		else if (!strcmp(argv[i], "--delay") && i+1 < argc) replay_delay = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--summary")) replay_delay = -1; /* a replay only prints its statistics */
+		else if (!strcmp(argv[i], "--stats")) stats_wanted = 1;
+		else if (!strcmp(argv[i], "--stats-json") && i+1 < argc) stats_json_path = argv[++i];
+		else if (!strcmp(argv[i], "--render") && i+1 < argc) {
+			const char *name = argv[++i];
+			for (view.mode = RENDER_COUNT-1; view.mode >= 0 && strcmp(render_names[view.mode], name); view.mode--) ;
+			if (view.mode < 0) return unknown_name(argv[0], "render mode", name);
+		}
+		else if (!strcmp(argv[i], "--algo") && i+1 < argc) {
+			const char *name = argv[++i];
+			algo = atoi(name) >= 1 && atoi(name) <= ALGO_COUNT ? atoi(name) : maze_algo_find(name);
+			if (algo < 0) return unknown_name(argv[0], "algorithm", name);
+		}
+		else if (!strcmp(argv[i], "--rows") && i+1 < argc) rows = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--cols") && i+1 < argc) cols = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && i+1 < argc) alt_threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i+1 < argc) {
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+			seed_set = 1;
+		}
+		else if (!strcmp(argv[i], "--gen") && i+1 < argc) {
+			const char *name = argv[++i];
+			if ((gen = maze_gen_find(name)) < 0) return unknown_name(argv[0], "generator", name);
+		} else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (stats_wanted || stats_json_path) atexit(stats_report);
+	if (suite) {
+		static const int default_sizes[] = { 101, 301, 1001 };
+		if (!nsizes) {
+			nsizes = 3;
+			memcpy(sizes, default_sizes, sizeof default_sizes);
+		}
+		/* fixed default seed so results line up with a baseline */
+		return run_suite(sizes, nsizes, seed_set ? seed : 1, nseeds < 1 ? 1 : nseeds, reps, warmup, json_path, baseline_path);
+	}
+	if (serve_path) return run_server(serve_path);
+	if (loadgen_path)
+		return run_loadgen(loadgen_path, alt_threads, requests, odd_at_least_11(rows ? rows : 101), odd_at_least_11(cols ? cols : 101),
+		                   gen, algo, seed);
+	if (batch) {
+		run_batch(batch, odd_at_least_11(rows ? rows : 101), odd_at_least_11(cols ? cols : 101), gen, algo, alt_threads, seed);
+		return 0;
+	}
+	if (replay_path) {
+		if (every < 1) every = 1;
+		if (replay_delay >= 0) {
+			enable_ansi_on_windows();
+			view_init();
+			hide_cursor();
+			atexit(show_cursor);
+			clear_screen();
+			raw_mode(1);
+		}
+		int err = replay_trace(replay_path, seek, every, replay_delay);
+		if (replay_delay >= 0) raw_mode(0);
+		return err ? 1 : 0;
+	}
+
+	Grid g;
+	int loaded = 0;
+	if (load_path) {
+		MazeInfo info;
+		double t0 = now_ms();
+		const char *err = maze_load(load_path, &g, &info, verify);
+		if (err) {
+			fprintf(stderr, "%s: %s\n", load_path, err);
+			return 1;
+		}
+		fprintf(stderr, "loaded %s: %dx%d seed %llu, %s body, %.2f ms\n", load_path, g.cols, g.rows,
+		        info.seed, info.flags & MF_PACKED ? "packed" : "mapped", now_ms() - t0);
+		if (info.gen < GEN_COUNT) gen = (int)info.gen;
+		seed = (unsigned)info.seed;
+		rows = g.rows;
+		cols = g.cols;
+		loaded = 1;
+	}
+	if (save_path || bench || export_path || record_path || trace_path) {
+		if (!loaded) {
+			rows = odd_at_least_11(rows ? rows : 501);
+			cols = odd_at_least_11(cols ? cols : 501);
+			grid_init(&g, rows, cols);
+			rng_seed(seed);
+			run_generator(gen, &g);
+		}
+		if (save_path && maze_save(save_path, &g, seed, gen, pack)) {
+			fprintf(stderr, "%s: write failed\n", save_path);
+			return 1;
+		}
+		if (bench) run_bench(&g, loaded ? load_path : gen_names[gen], seed);
+		if (record_path) {
+			recorder = recorder_open(record_path, &g, every, scale);
+			if (!recorder) {
+				fprintf(stderr, "%s: cannot record (GIFs are limited to 65535 px per side; frame patterns need one %%d)\n", record_path);
+				return 1;
+			}
+			double t0 = now_ms();
+			solve(algo, &g, 1, 1, rows-2, cols-2, -1);
+			long frames = recorder_close(recorder, &g, 1, 1, rows-2, cols-2);
+			recorder = NULL;
+			fprintf(stderr, "%s recorded to %s: %ld frames in %.2f ms\n", algo_names[algo], record_path, frames, now_ms() - t0);
+		}
+		if (trace_path) {
+			tracer = trace_open(trace_path, &g, 1, 1, rows-2, cols-2);
+			if (!tracer) {
+				fprintf(stderr, "%s: cannot create trace\n", trace_path);
+				return 1;
+			}
+			double t0 = now_ms();
+			solve(algo, &g, 1, 1, rows-2, cols-2, -1);
+			long long events = tracer->events;
+			size_t size;
+			int failed = trace_close(tracer, &size);
+			tracer = NULL;
+			if (failed) {
+				fprintf(stderr, "%s: write failed\n", trace_path);
+				return 1;
+			}
+			fprintf(stderr, "%s traced to %s: %lld events, %zu bytes (%.2f bytes/event) in %.2f ms\n", algo_names[algo],
+			        trace_path, events, size, events ? (double)size / events : 0.0, now_ms() - t0);
+		}
+		if (export_path) {
+			double t0 = now_ms();
+			solve(algo, &g, 1, 1, rows-2, cols-2, -1);
+			double t1 = now_ms();
+			if (export_image(&g, 1, 1, rows-2, cols-2, scale, export_path)) {
+				fprintf(stderr, "%s: export failed\n", export_path);
+				return 1;
+			}
+			fprintf(stderr, "%s solve %.2f ms, exported %s in %.2f ms\n", algo_names[algo], t1 - t0, export_path, now_ms() - t1);
+		}
+		grid_free(&g);
+		return 0;
+	}
+
+	rng_seed(seed);
+	enable_ansi_on_windows();
+	view_init();
+	hide_cursor();
+	atexit(show_cursor);
+
+	printf("\nMAZE VISUALIZER- C\n");
+	
+	if (!loaded) {
+		cols = odd_at_least_11(get_int_with_default("Enter odd number of columns", 31));
+		rows = odd_at_least_11(get_int_with_default("Enter odd number of rows", 21));
+	}
+
+	int algo_choice = get_int_with_default("Choose algorithm: 1=DFS (explore), 2=BFS (shortest), 3=Dijkstra (weighted),\n"
+	                                       "4=A*, 5=JPS (open grids), 6=JPS+ (precomputed jumps), 7=HPA* (clusters),\n"
+	                                       "8=A* with ALT landmarks", 2);
+	if (algo_choice < 1 || algo_choice > ALGO_COUNT) algo_choice = 2;
+	gen = get_int_with_default("Maze type: 1=perfect maze, 2=weighted terrain, 3=open rooms", 1) - 1;
+	if (gen < 0 || gen >= GEN_COUNT) gen = 0;
+	int delay = get_int_with_default("Animation delay in ms (0..200), smaller -> faster", 40);
+
+	if (!loaded) grid_init(&g, rows, cols);
+	int sr = 1, sc = 1, er = rows-2, ec = cols-2;
+
+	while (1) {
+		if (loaded) loaded = 0; /* solve the file's maze first */
+		else {
+			if (g.map) {
+				grid_free(&g);
+				grid_init(&g, rows, cols);
+			}
+			run_generator(gen, &g);
+		}
+		clear_screen();
+		move_cursor_home();
+		draw_grid(&g, sr, sc, er, ec);
+		printf("\nGenerated %s %dx%d. Press Enter to start solver", gen_names[gen], cols, rows);
+		fflush(stdout);
+		getchar();
+
+		raw_mode(1); /* arrows/hjkl pan and f follows while the solver runs */
+		solve(algo_choice, &g, sr, sc, er, ec, delay);
+		raw_mode(0);
+
+		int c;
+		for (;;) {
+			draw_grid(&g, sr, sc, er, ec);
+			printf("\nSolver finished. Options:\n[r] Regenerate  [a] Toggle algorithm  [t] Toggle maze type  [e] Edit walls  [v] Pan view  [x] Export PNG  [q] Quit\n");
+			c = getchar();
+			if (c == '\n') c = getchar();
+			if (c != 'v' && c != 'V') break;
+			getchar();
+			pan_view(&g, sr, sc, er, ec);
+		}
+		if (c == 'q' || c == 'Q') break;
+		if (c == 'a' || c == 'A') {
+			algo_choice = algo_choice % ALGO_COUNT + 1;
+			printf("Toggled algorithm to %s\n", algo_names[algo_choice]);
+			printf("Press Enter: ");
+			getchar();
+		}
+		if (c == 'e' || c == 'E') {
+			getchar();
+			grid_make_writable(&g);
+			edit_walls(&g, sr, sc, er, ec);
+			draw_grid(&g, sr, sc, er, ec);
+			printf("\nEdited maze kept for this round. Press Enter to regenerate: ");
+			getchar();
+		}
+		if (c == 'x' || c == 'X') {
+			int ok = !export_image(&g, sr, sc, er, ec, 8, "maze.png");
+			printf(ok ? "Saved maze.png\n" : "Could not write maze.png\n");
+			printf("Press Enter: ");
+			getchar();
+			getchar();
+		}
+		if (c == 't' || c == 'T') {
+			gen = (gen + 1) % GEN_COUNT;
+			printf("Toggled maze type to %s\n", gen_names[gen]);
+			printf("Press Enter: ");
+			getchar();
+		}
+	}
+
+	grid_free(&g);
+	clear_screen();
+	show_cursor();
+	printf("Thank you!\n");
+	return 0;
+}
+
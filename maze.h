@@ -0,0 +1,112 @@
+/* maze.h - libmaze: grid storage, maze generators, path solvers and
+   renderers behind a small C API.
+   Build the library and every program using it with the same MAZE_TILED
+   and MAZE_NO_STATS settings. State that outlives a call (solver tables,
+   scratch memory, the PRNG, the terminal view) is per thread, so threads
+   may work on separate grids concurrently. The terminal itself is shared:
+   draw it with maze_render_ansi from one thread at a time.
+*/
+#ifndef MAZE_H
+#define MAZE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* MAZE_BUILD is defined while building the library itself; programs
+   linking the static library on Windows define MAZE_STATIC */
+#if (defined(_WIN32) || defined(_WIN64)) && defined(MAZE_BUILD)
+#define MAZE_API __declspec(dllexport)
+#elif (defined(_WIN32) || defined(_WIN64)) && !defined(MAZE_STATIC)
+#define MAZE_API __declspec(dllimport)
+#elif defined(__GNUC__)
+#define MAZE_API __attribute__((visibility("default")))
+#else
+#define MAZE_API
+#endif
+
+typedef struct MazeGrid MazeGrid;
+
+/* cell bits: MAZE_WALL, and the traversal cost (1..15, 0 = 1) of an open
+   cell in the high nibble */
+#define MAZE_WALL 1
+#define MAZE_COST_SHIFT 4
+/* mark bits set by the solvers */
+#define MAZE_VISIT 1
+#define MAZE_FRONT 2
+#define MAZE_PATH 4
+
+enum { MAZE_GEN_MAZE, MAZE_GEN_TERRAIN, MAZE_GEN_ROOMS, MAZE_GEN_COUNT };
+enum { MAZE_DFS = 1, MAZE_BFS, MAZE_DIJKSTRA, MAZE_ASTAR, MAZE_JPS, MAZE_JPS_PLUS, MAZE_HPA, MAZE_ALT, MAZE_ALGO_LAST = MAZE_ALT };
+
+/* grids: rows x cols cells, all wall until generated. Cells are numbered
+   row-major (cell = r*cols + c) everywhere in this API. */
+MAZE_API MazeGrid *maze_grid_new(int rows, int cols);
+MAZE_API void maze_grid_free(MazeGrid *g);
+MAZE_API int maze_rows(const MazeGrid *g);
+MAZE_API int maze_cols(const MazeGrid *g);
+MAZE_API int maze_cell(const MazeGrid *g, int r, int c);
+MAZE_API void maze_set_cell(MazeGrid *g, int r, int c, int v);
+MAZE_API int maze_mark(const MazeGrid *g, int r, int c);
+MAZE_API void maze_clear_marks(MazeGrid *g);
+
+/* maze files: save returns 0 on success (gen -1 for grids that were not
+   generated); load returns NULL and sets *err on failure, and sets *gen to
+   -1 when the file has no known generator */
+MAZE_API int maze_grid_save(const MazeGrid *g, const char *path, unsigned long long seed, int gen, int packed);
+MAZE_API MazeGrid *maze_grid_load(const char *path, int verify, unsigned long long *seed, int *gen, const char **err);
+
+/* generators: the same seed gives the same maze on every platform */
+MAZE_API void maze_generate(MazeGrid *g, int gen, unsigned long long seed);
+MAZE_API const char *maze_gen_name(int gen);
+MAZE_API int maze_gen_find(const char *name); /* -1 if unknown */
+
+/* solver observer, all callbacks optional. on_frontier, on_visit and
+   on_path follow every change to a cell's marks, with before = its previous
+   mark bits; on_done ends the solve with the number of path cells. A solve
+   without an observer runs a headless copy of the solver in which the
+   notifications compile away. */
+typedef struct {
+	void (*on_frontier)(void *ctx, const MazeGrid *g, int cell, int before);
+	void (*on_visit)(void *ctx, const MazeGrid *g, int cell, int before);
+	void (*on_path)(void *ctx, const MazeGrid *g, int cell, int before);
+	void (*on_done)(void *ctx, const MazeGrid *g, long path_cells);
+	void *ctx;
+} MazeObserver;
+
+/* solves (sr,sc) -> (er,ec), leaving MAZE_VISIT/FRONT/PATH marks; returns
+   the number of path cells, 0 when the goal is unreachable */
+MAZE_API long maze_solve(MazeGrid *g, int algo, int sr, int sc, int er, int ec, const MazeObserver *obs);
+MAZE_API const char *maze_algo_name(int algo);
+MAZE_API int maze_algo_find(const char *name); /* -1 if unknown */
+/* multi-source, multi-target BFS in one sweep (unit steps, costs ignored):
+   every cell is reached from its nearest source, and the sweep stops at the
+   first target reached (MAZE_STOP_ANY), once all are (MAZE_STOP_ALL), or,
+   without targets, when everything reachable is. Paths to the reached
+   targets are marked MAZE_PATH. The result stays valid while the grid is
+   unchanged: maze_multi_path gives the steps from the nearest source to any
+   reached cell (-1 if not reached) and stores up to cap cells of the path,
+   source first. */
+typedef struct MazeMulti MazeMulti;
+enum { MAZE_STOP_ANY, MAZE_STOP_ALL };
+MAZE_API MazeMulti *maze_search_multi(MazeGrid *g, const int *sources, int nsources, const int *targets, int ntargets,
+                                      int stop, const MazeObserver *obs);
+MAZE_API int maze_multi_reached(const MazeMulti *m); /* distinct target cells reached */
+MAZE_API long maze_multi_path(const MazeMulti *m, int cell, int *path, long cap);
+MAZE_API void maze_multi_free(MazeMulti *m);
+
+/* frees the calling thread's solver tables, scratch memory and view */
+MAZE_API void maze_thread_release(void);
+
+/* renderers: the grid and its marks as a PNG or PPM image (by extension),
+   scale x scale pixels per cell, 0 on success; or as ANSI colours on
+   stdout, clipped to the terminal and redrawing only what changed since
+   the last call */
+MAZE_API int maze_export_image(const MazeGrid *g, int sr, int sc, int er, int ec, int scale, const char *path);
+MAZE_API void maze_render_ansi(const MazeGrid *g, int sr, int sc, int er, int ec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+/* maze_gen.c - maze generators */
+
+#include "maze_internal.h"
+
+/* generate perfect maze (iterative backtracker). Odd cells stay walled
+   until carved into, so the wall bit doubles as the visited flag and the
+   reset is a single fill (tile padding included). */
+typedef struct {
+	int r,c;
+} CellRC;
+
+static void generate_maze(Grid *g) {
+	int rows = g->rows, cols = g->cols;
+	grid_touch(g);
+	memset(g->cells, 1, g->n);
+
+	int maxcells = (rows/2)*(cols/2);
+	CellRC *stack = scratch_alloc(maxcells * sizeof(CellRC));
+	int top = 0;
+	stack[top++] = (CellRC) {
+		1,1
+	};
+	grid_set(g, 1, 1, 0);
+
+	while (top > 0) {
+		CellRC cur = stack[top-1];
+		int r = cur.r, c = cur.c;
+		int dirs[4][2] = {{-2,0},{2,0},{0,-2},{0,2}};
+		int choices[4], ch=0;
+		for (int i=0; i<4; i++) {
+			int nr = r + dirs[i][0], nc = c + dirs[i][1];
+			if (nr>0 && nr<rows-1 && nc>0 && nc<cols-1) {
+				STAT_ADD(neighbours, 1);
+				if (cell_is_wall(grid_get(g,nr,nc))) choices[ch++]=i;
+			}
+		}
+		if (ch>0) {
+			int pick = choices[rng_int()%ch];
+			int nr = r + dirs[pick][0], nc = c + dirs[pick][1];
+			int wr = r + dirs[pick][0]/2, wc = c + dirs[pick][1]/2;
+			grid_set(g, wr, wc, 0);
+			grid_set(g, nr, nc, 0);
+			stack[top++] = (CellRC) {
+				nr,nc
+			};
+			STAT_ADD(pushes, 1);
+			STAT_DEPTH(top);
+		} else {
+			--top;
+		}
+	}
+}
+
+/* weighted terrain: a perfect maze braided by knocking out part of the inner
+   walls (so several routes compete), with smooth value-noise costs 1..15 */
+#define TERRAIN_STEP 6
+#define TERRAIN_BRAID 4 /* one in N removable walls is opened */
+
+static void generate_terrain(Grid *g) {
+	int rows = g->rows, cols = g->cols;
+	generate_maze(g);
+	for (int r=1; r<rows-1; r++) for (int c=1; c<cols-1; c++) {
+		/* walls between two odd cells, never the pillars at (even, even) */
+		if ((r+c) % 2 == 1 && grid_get(g,r,c) == 1 && rng_int()%TERRAIN_BRAID == 0)
+			grid_set(g, r, c, 0);
+	}
+
+	int lr = rows/TERRAIN_STEP + 2, lc = cols/TERRAIN_STEP + 2;
+	int *lat = scratch_alloc(sizeof(int)*lr*lc);
+	for (int i=0; i<lr*lc; i++) lat[i] = rng_int() % CELL_COST_MAX;
+	for (int r=0; r<rows; r++) for (int c=0; c<cols; c++) {
+		if (cell_is_wall(grid_get(g,r,c))) continue;
+		int y = r/TERRAIN_STEP, x = c/TERRAIN_STEP;
+		int fy = r%TERRAIN_STEP, fx = c%TERRAIN_STEP;
+		int top = lat[y*lc + x]*(TERRAIN_STEP-fx) + lat[y*lc + x+1]*fx;
+		int bot = lat[(y+1)*lc + x]*(TERRAIN_STEP-fx) + lat[(y+1)*lc + x+1]*fx;
+		int v = (top*(TERRAIN_STEP-fy) + bot*fy) / (TERRAIN_STEP*TERRAIN_STEP);
+		grid_set(g, r, c, (cell_t)((1 + v) << CELL_COST_SHIFT));
+	}
+	grid_touch(g);
+}
+
+/* open rooms: a lattice of ROOM-sized rooms joined by 1..2 doors per wall,
+   the open layout where BFS and A* waste most of their expansions */
+#define ROOM 10
+
+static void open_door(Grid *g, int r, int c, int dr, int dc, int len) {
+	int w = 1 + rng_int()%3;
+	int at = 1 + rng_int()%(len-1);
+	for (int i=0; i<w && at+i<len; i++) grid_set(g, r + dr*(at+i), c + dc*(at+i), 0);
+}
+
+static void generate_rooms(Grid *g) {
+	int rows = g->rows, cols = g->cols;
+	grid_touch(g);
+	/* two row templates: a wall line and a row crossing rooms */
+	cell_t *wall = scratch_alloc(cols), *room = scratch_alloc(cols);
+	memset(wall, 1, cols);
+	for (int c=0; c<cols; c++) room[c] = c==0 || c==cols-1 || c%ROOM==0;
+	for (int r=0; r<rows; r++) grid_set_row(g, r, r==0 || r==rows-1 || r%ROOM==0 ? wall : room);
+	/* ROOM is even and rows/cols are odd, so rows-2/cols-2 never hit a wall line */
+	for (int r=ROOM; r<rows-1; r+=ROOM) for (int c=0; c<cols-1; c+=ROOM) {
+		int len = (c+ROOM < cols-1 ? ROOM : cols-1-c);
+		if (len < 2) continue;
+		open_door(g, r, c, 0, 1, len);
+		if (rng_int()%2) open_door(g, r, c, 0, 1, len);
+	}
+	for (int c=ROOM; c<cols-1; c+=ROOM) for (int r=0; r<rows-1; r+=ROOM) {
+		int len = (r+ROOM < rows-1 ? ROOM : rows-1-r);
+		if (len < 2) continue;
+		open_door(g, r, c, 1, 0, len);
+		if (rng_int()%2) open_door(g, r, c, 1, 0, len);
+	}
+}
+
+static void (*const generators[])(Grid*) = { generate_maze, generate_terrain, generate_rooms };
+const char *gen_names[GEN_COUNT] = { "maze", "terrain", "rooms" };
+
+/* generator entry point, timed for the stats phases; releases its scratch
+   when done */
+void run_generator(int gen, Grid *g) {
+#ifndef MAZE_NO_STATS
+	double t0 = now_ms();
+	generators[gen](g);
+	stats.phase_ms[PH_GEN] += now_ms() - t0;
+	stats.gens++;
+#else
+	generators[gen](g);
+#endif
+	scratch_reset();
+}
+
+void maze_generate(MazeGrid *g, int gen, unsigned long long seed) {
+	if (gen < 0 || gen >= GEN_COUNT) return;
+	grid_make_writable(g);
+	rng_seed(seed);
+	run_generator(gen, g);
+}
+const char *maze_gen_name(int gen) {
+	return gen >= 0 && gen < GEN_COUNT ? gen_names[gen] : NULL;
+}
+int maze_gen_find(const char *name) {
+	for (int i=0; i<GEN_COUNT; i++)
+		if (!strcmp(gen_names[i], name)) return i;
+	return -1;
+}
@@ -0,0 +1,570 @@
+/* maze_grid.c - platform helpers, memory, stats and grid storage and files */
+
+#include "maze_internal.h"
+
+/* portable sleep ms */
+static void sleep_ms(int ms) {
+#if defined(_WIN32) || defined(_WIN64)
+	Sleep(ms);
+#else
+	if (ms > 0) usleep(ms * 1000);
+#endif
+}
+
+/* portable monotonic clock in ms */
+double now_ms(void) {
+#if defined(_WIN32) || defined(_WIN64)
+	LARGE_INTEGER f, t;
+	QueryPerformanceFrequency(&f);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart * 1000.0 / (double)f.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+/* allocation wrappers: running out of memory is fatal everywhere, and the
+   counts (per thread) feed the benchmark and stats reports */
+THREAD_LOCAL unsigned long long alloc_count, alloc_bytes;
+static void out_of_memory(void) {
+	fprintf(stderr,"Out of memory\n");
+	exit(1);
+}
+void *xmalloc(size_t n) {
+	void *p = malloc(n ? n : 1);
+	if (!p) out_of_memory();
+	alloc_count++;
+	alloc_bytes += n;
+	return p;
+}
+void *xcalloc(size_t n, size_t size) {
+	void *p = calloc(n ? n : 1, size ? size : 1);
+	if (!p) out_of_memory();
+	alloc_count++;
+	alloc_bytes += n * size;
+	return p;
+}
+void *xrealloc(void *old, size_t n) {
+	void *p = realloc(old, n ? n : 1);
+	if (!p) out_of_memory();
+	alloc_count++;
+	alloc_bytes += n;
+	return p;
+}
+
+/* scratch arena: the per-run buffers of a generate or solve call (parents,
+   distances, visit state, generator stacks) are bump-allocated from
+   per-thread blocks and all released at once by scratch_reset() when the
+   call returns. After a run outgrew one block the next run gets a single
+   block of the combined size, so steady-state runs allocate nothing.
+   Blocks of ARENA_HUGE or more are mapped on a huge-page boundary and
+   offered to the kernel as transparent huge pages. */
+#define ARENA_MIN ((size_t)64 << 10)
+#define ARENA_HUGE ((size_t)2 << 20)
+#define ARENA_ALIGN 64 /* whole cache lines, also the block header size */
+typedef struct ArenaBlock {
+	struct ArenaBlock *next; /* older, full blocks */
+	size_t size, used;
+} ArenaBlock;
+static THREAD_LOCAL ArenaBlock *scratch;
+static THREAD_LOCAL size_t scratch_want; /* size of the next first block */
+
+static ArenaBlock *arena_block_new(size_t size) {
+	ArenaBlock *b;
+	if (size >= ARENA_HUGE) {
+		size = (size + ARENA_HUGE-1) & ~(ARENA_HUGE-1);
+#if defined(_WIN32) || defined(_WIN64)
+		b = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE); /* large pages need a privilege */
+		if (!b) out_of_memory();
+#else
+		/* over-map by one huge page and trim, so the block is 2 MB aligned */
+		char *p = mmap(NULL, size + ARENA_HUGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) out_of_memory();
+		size_t head = (ARENA_HUGE - ((size_t)p & (ARENA_HUGE-1))) & (ARENA_HUGE-1);
+		if (head) munmap(p, head);
+		munmap(p + head + size, ARENA_HUGE - head);
+		b = (ArenaBlock*)(p + head);
+#ifdef MADV_HUGEPAGE
+		madvise(b, size, MADV_HUGEPAGE);
+#endif
+#endif
+		alloc_count++;
+		alloc_bytes += size;
+	} else {
+		b = xmalloc(size);
+	}
+	b->next = NULL;
+	b->size = size;
+	b->used = ARENA_ALIGN;
+	return b;
+}
+static void arena_block_free(ArenaBlock *b) {
+	if (b->size >= ARENA_HUGE) {
+#if defined(_WIN32) || defined(_WIN64)
+		VirtualFree(b, 0, MEM_RELEASE);
+#else
+		munmap(b, b->size);
+#endif
+	} else {
+		free(b);
+	}
+}
+
+void *scratch_alloc(size_t n) {
+	n = (n + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+	if (!scratch || scratch->size - scratch->used < n) {
+		size_t size = scratch ? scratch->size * 2 : scratch_want;
+		if (size < ARENA_MIN) size = ARENA_MIN;
+		if (size < n + ARENA_ALIGN) size = n + ARENA_ALIGN;
+		ArenaBlock *b = arena_block_new(size);
+		b->next = scratch;
+		scratch = b;
+	}
+	void *p = (char*)scratch + scratch->used;
+	scratch->used += n;
+	return p;
+}
+/* ends a run: everything from scratch_alloc() is gone */
+void scratch_reset(void) {
+	if (!scratch) return;
+	if (!scratch->next) {
+		scratch->used = ARENA_ALIGN;
+		return;
+	}
+	size_t total = 0;
+	while (scratch) {
+		ArenaBlock *b = scratch;
+		scratch = b->next;
+		total += b->size;
+		arena_block_free(b);
+	}
+	scratch_want = total;
+}
+void scratch_free(void) {
+	scratch_reset();
+	if (scratch) arena_block_free(scratch);
+	scratch = NULL;
+	scratch_want = 0;
+}
+
+
+/* PRNG state, see rng_int */
+THREAD_LOCAL unsigned long long rng_state;
+
+#ifndef MAZE_NO_STATS
+const char *phase_names[PH_COUNT] = { "generate", "search", "render", "sleep" };
+THREAD_LOCAL Stats stats;
+void stats_merge(Stats *into, const Stats *from) {
+	into->pushes += from->pushes;
+	into->pops += from->pops;
+	into->neighbours += from->neighbours;
+	if (from->max_depth > into->max_depth) into->max_depth = from->max_depth;
+	into->gens += from->gens;
+	into->solves += from->solves;
+	into->draws += from->draws;
+	into->draw_bytes += from->draw_bytes;
+	for (int i=0; i<PH_COUNT; i++) into->phase_ms[i] += from->phase_ms[i];
+}
+#endif
+
+void stats_sleep(int ms) {
+#ifndef MAZE_NO_STATS
+	double t0 = now_ms();
+	sleep_ms(ms);
+	stats.phase_ms[PH_SLEEP] += now_ms() - t0;
+#else
+	sleep_ms(ms);
+#endif
+}
+
+
+/* portable threads */
+#if defined(_WIN32) || defined(_WIN64)
+typedef struct {
+	void *(*fn)(void*);
+	void *arg;
+} ThreadStart;
+static DWORD WINAPI thread_trampoline(LPVOID p) {
+	ThreadStart ts = *(ThreadStart*)p;
+	free(p);
+	ts.fn(ts.arg);
+	return 0;
+}
+void thread_start(thread_t *t, void *(*fn)(void*), void *arg) {
+	ThreadStart *ts = xmalloc(sizeof(ThreadStart));
+	ts->fn = fn;
+	ts->arg = arg;
+	*t = CreateThread(NULL, 0, thread_trampoline, ts, 0, NULL);
+}
+void thread_join(thread_t t) {
+	WaitForSingleObject(t, INFINITE);
+	CloseHandle(t);
+}
+int cpu_count(void) {
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (int)si.dwNumberOfProcessors;
+}
+void mutex_init(mutex_t *m) {
+	InitializeCriticalSection(m);
+}
+void mutex_lock(mutex_t *m) {
+	EnterCriticalSection(m);
+}
+void mutex_unlock(mutex_t *m) {
+	LeaveCriticalSection(m);
+}
+void mutex_destroy(mutex_t *m) {
+	DeleteCriticalSection(m);
+}
+#else
+void thread_start(thread_t *t, void *(*fn)(void*), void *arg) {
+	pthread_create(t, NULL, fn, arg);
+}
+void thread_join(thread_t t) {
+	pthread_join(t, NULL);
+}
+int cpu_count(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+}
+void mutex_init(mutex_t *m) {
+	pthread_mutex_init(m, NULL);
+}
+void mutex_lock(mutex_t *m) {
+	pthread_mutex_lock(m);
+}
+void mutex_unlock(mutex_t *m) {
+	pthread_mutex_unlock(m);
+}
+void mutex_destroy(mutex_t *m) {
+	pthread_mutex_destroy(m);
+}
+#endif
+
+/* peak resident set size in KB, 0 if unknown */
+long peak_rss_kb(void) {
+#if defined(_WIN32) || defined(_WIN64)
+	PROCESS_MEMORY_COUNTERS pmc;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof pmc) ? (long)(pmc.PeakWorkingSetSize / 1024) : 0;
+#else
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru)) return 0;
+#ifdef __APPLE__
+	return ru.ru_maxrss / 1024; /* bytes there */
+#else
+	return ru.ru_maxrss;
+#endif
+#endif
+}
+
+
+/* versions come from one process-wide counter, so the tables cached by
+   version (JPS+, ALT, HPA*, overview) never mistake one grid for another */
+static volatile long grid_versions;
+void grid_touch(Grid *g) {
+#if defined(_WIN32) || defined(_WIN64)
+	g->version = (unsigned)InterlockedIncrement(&grid_versions);
+#else
+	g->version = (unsigned)__atomic_add_fetch(&grid_versions, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+void grid_init(Grid *g, int rows, int cols) {
+	g->rows = rows;
+	g->cols = cols;
+#ifdef MAZE_TILED
+	g->tcols = (cols + TILE-1) >> TILE_SHIFT;
+	g->n = ((rows + TILE-1) >> TILE_SHIFT) * g->tcols * TILE*TILE;
+#else
+	g->n = rows * cols;
+#endif
+	g->cells = xmalloc(g->n);
+	g->marks = xmalloc(g->n);
+	memset(g->cells, 1, g->n); /* tile padding stays wall */
+	memset(g->marks, M_NONE, g->n);
+	grid_touch(g);
+	g->map = NULL;
+}
+void grid_free(Grid *g) {
+	overview_forget(g);
+	if (g->map) unmap_file(g->map, g->map_len);
+	else free(g->cells);
+	free(g->marks);
+	g->cells = NULL;
+	g->marks = NULL;
+	g->map = NULL;
+}
+/* copies cells out of a loaded file's mapping before they are edited */
+void grid_make_writable(Grid *g) {
+	if (!g->map) return;
+	cell_t *cells = xmalloc(g->n);
+	memcpy(cells, g->cells, g->n);
+	unmap_file(g->map, g->map_len);
+	g->cells = cells;
+	g->map = NULL;
+}
+
+/* 1 when the outer ring is all wall: every step from an open cell then lands
+   inside the grid, so flat-index solvers can step by nbr_offsets without
+   bounds checks. Generated mazes always are; loaded or edited ones may not. */
+int grid_walled(const Grid *g) {
+	int rows = g->rows, cols = g->cols;
+	for (int c=0; c<cols; c++)
+		if (!cell_is_wall(grid_get(g,0,c)) || !cell_is_wall(grid_get(g,rows-1,c))) return 0;
+	for (int r=0; r<rows; r++)
+		if (!cell_is_wall(grid_get(g,r,0)) || !cell_is_wall(grid_get(g,r,cols-1))) return 0;
+	return 1;
+}
+/* stores a row of cols cells: one copy, or one per tile when tiled */
+void grid_set_row(Grid *g, int r, const cell_t *row) {
+#ifdef MAZE_TILED
+	for (int c=0; c<g->cols; c+=TILE) {
+		int w = g->cols - c < TILE ? g->cols - c : TILE;
+		memcpy(&g->cells[grid_index(g, r, c)], row + c, w);
+	}
+#else
+	memcpy(&g->cells[grid_index(g, r, 0)], row, g->cols);
+#endif
+}
+
+void put_le(unsigned char *p, unsigned long long v, int n) {
+	for (int i=0; i<n; i++) p[i] = (unsigned char)(v >> (8*i));
+}
+unsigned long long get_le(const unsigned char *p, int n) {
+	unsigned long long v = 0;
+	for (int i=n-1; i>=0; i--) v = v << 8 | p[i];
+	return v;
+}
+static unsigned fnv1a(unsigned h, const unsigned char *p, size_t n) {
+	for (size_t i=0; i<n; i++) h = (h ^ p[i]) * 16777619u;
+	return h;
+}
+#define FNV_SEED 2166136261u
+
+/* packed body: wall bitplane, then the cost nibbles when costs is set */
+size_t cells_packed_size(size_t n, int costs) {
+	return (n+7)/8 + (costs ? (n+1)/2 : 0);
+}
+int cells_have_costs(const cell_t *cells, size_t n) {
+	for (size_t i=0; i<n; i++) if (cells[i] >> CELL_COST_SHIFT) return 1;
+	return 0;
+}
+void cells_pack(const cell_t *cells, size_t n, int costs, unsigned char *out) {
+	memset(out, 0, cells_packed_size(n, costs));
+	for (size_t i=0; i<n; i++) {
+		if (cell_is_wall(cells[i])) out[i/8] |= 1 << (i%8);
+		if (costs) out[(n+7)/8 + i/2] |= (cells[i] >> CELL_COST_SHIFT) << (4*(i%2));
+	}
+}
+void cells_unpack(const unsigned char *in, size_t n, int costs, cell_t *cells) {
+	for (size_t i=0; i<n; i++) {
+		cell_t v = (in[i/8] >> (i%8)) & 1;
+		if (costs) v |= ((in[(n+7)/8 + i/2] >> (4*(i%2))) & 15) << CELL_COST_SHIFT;
+		cells[i] = v;
+	}
+}
+/* cells in file order (row-major): the grid's own array, or a copy when
+   the cells are tiled; release with cells_rows_done */
+cell_t *cells_rows(const Grid *g) {
+#ifdef MAZE_TILED
+	cell_t *out = xmalloc((size_t)g->rows * g->cols);
+	for (int r=0; r<g->rows; r++) for (int c=0; c<g->cols; c++) out[(size_t)r*g->cols + c] = grid_get(g,r,c);
+	return out;
+#else
+	return g->cells;
+#endif
+}
+void cells_rows_done(const Grid *g, cell_t *rows) {
+	if (rows != g->cells) free(rows);
+}
+/* stores row-major cells in the grid's layout */
+void cells_from_rows(Grid *g, const cell_t *src) {
+#ifdef MAZE_TILED
+	for (int r=0; r<g->rows; r++) grid_set_row(g, r, src + (size_t)r*g->cols);
+#else
+	memcpy(g->cells, src, g->n);
+#endif
+}
+
+/* returns 0 on success */
+int maze_save(const char *path, const Grid *g, unsigned long long seed, unsigned gen, int packed) {
+	size_t n = (size_t)g->rows * g->cols, body = n;
+	cell_t *cells = cells_rows(g);
+	int costs = packed && cells_have_costs(cells, n);
+	unsigned char *buf = NULL;
+	if (packed) {
+		body = cells_packed_size(n, costs);
+		buf = xmalloc(body);
+		cells_pack(cells, n, costs, buf);
+	}
+	const unsigned char *src = packed ? buf : cells;
+	unsigned char h[MF_HEADER] = { 'M','A','Z','E' };
+	put_le(h+4, MF_VERSION, 2);
+	put_le(h+6, MF_HEADER, 2);
+	put_le(h+8, g->rows, 4);
+	put_le(h+12, g->cols, 4);
+	put_le(h+16, seed, 8);
+	put_le(h+24, gen, 4);
+	put_le(h+28, (packed ? MF_PACKED : 0) | (costs ? MF_COSTS : 0), 4);
+	put_le(h+32, MF_HEADER, 8);
+	put_le(h+40, body, 8);
+	put_le(h+48, fnv1a(FNV_SEED, src, body), 4);
+	FILE *f = fopen(path, "wb");
+	int ok = f && fwrite(h, 1, MF_HEADER, f) == MF_HEADER && fwrite(src, 1, body, f) == body;
+	if (f && fclose(f)) ok = 0;
+	free(buf);
+	cells_rows_done(g, cells);
+	return ok ? 0 : -1;
+}
+
+/* maps the whole file; on Windows it is read into memory instead */
+int map_file(const char *path, unsigned char **data, size_t *len) {
+#if defined(_WIN32) || defined(_WIN64)
+	FILE *f = fopen(path, "rb");
+	if (!f) return -1;
+	fseek(f, 0, SEEK_END);
+	*len = (size_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+	*data = xmalloc(*len ? *len : 1);
+	int ok = *data && fread(*data, 1, *len, f) == *len;
+	fclose(f);
+	if (!ok) free(*data);
+	return ok ? 0 : -1;
+#else
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0) return -1;
+	if (fstat(fd, &st) || st.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+	*len = (size_t)st.st_size;
+	*data = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	return *data == MAP_FAILED ? -1 : 0;
+#endif
+}
+void unmap_file(void *data, size_t len) {
+#if defined(_WIN32) || defined(_WIN64)
+	(void)len;
+	free(data);
+#else
+	munmap(data, len);
+#endif
+}
+
+/* loads a maze file into g. Raw bodies are not copied: g->cells points into
+   the read-only mapping (see grid_make_writable); only marks are allocated.
+   verify also checks the body checksum, which reads the whole body.
+   Returns NULL on success, otherwise a message describing the failure. */
+const char *maze_load(const char *path, Grid *g, MazeInfo *info, int verify) {
+	unsigned char *data;
+	size_t len;
+	if (map_file(path, &data, &len)) return "cannot open or map file";
+	const char *err = NULL;
+	unsigned long long rows = 0, cols = 0, off = 0, body = 0, n = 0;
+	if (len < MF_HEADER || memcmp(data, "MAZE", 4)) err = "not a maze file";
+	else if (get_le(data+4, 2) != MF_VERSION) err = "unsupported version";
+	else {
+		rows = get_le(data+8, 4);
+		cols = get_le(data+12, 4);
+		off = get_le(data+32, 8);
+		body = get_le(data+40, 8);
+		info->seed = get_le(data+16, 8);
+		info->gen = (unsigned)get_le(data+24, 4);
+		info->flags = (unsigned)get_le(data+28, 4);
+		info->checksum = (unsigned)get_le(data+48, 4);
+		n = rows * cols;
+		unsigned long long want = info->flags & MF_PACKED ? cells_packed_size(n, info->flags & MF_COSTS) : n;
+		if (rows < 3 || cols < 3 || n > INT_MAX) err = "bad dimensions";
+		else if (body != want || off < MF_HEADER || off > len || len - off < body) err = "truncated body";
+		else if (verify && fnv1a(FNV_SEED, data + off, body) != info->checksum) err = "checksum mismatch";
+	}
+	if (err) {
+		unmap_file(data, len);
+		return err;
+	}
+#ifdef MAZE_TILED
+	/* tiled cells can't point into the file: always converted */
+	grid_init(g, (int)rows, (int)cols);
+	cell_t *src = data + off;
+	if (info->flags & MF_PACKED) {
+		src = xmalloc(n);
+		cells_unpack(data + off, n, info->flags & MF_COSTS, src);
+	}
+	cells_from_rows(g, src);
+	if (src != data + off) free(src);
+	unmap_file(data, len);
+#else
+	g->rows = (int)rows;
+	g->cols = (int)cols;
+	g->n = (int)n;
+	grid_touch(g);
+	g->marks = xcalloc(n, 1);
+	if (info->flags & MF_PACKED) {
+		g->cells = xmalloc(n);
+		cells_unpack(data + off, n, info->flags & MF_COSTS, g->cells);
+		unmap_file(data, len);
+		g->map = NULL;
+	} else {
+		g->cells = data + off;
+		g->map = data;
+		g->map_len = len;
+	}
+#endif
+	return NULL;
+}
+
+
+/* public grid API */
+MazeGrid *maze_grid_new(int rows, int cols) {
+	if (rows < 3 || cols < 3 || (long long)rows * cols > INT_MAX) return NULL;
+	Grid *g = xmalloc(sizeof(Grid));
+	grid_init(g, rows, cols);
+	return g;
+}
+void maze_grid_free(MazeGrid *g) {
+	if (!g) return;
+	grid_free(g);
+	free(g);
+}
+int maze_rows(const MazeGrid *g) {
+	return g->rows;
+}
+int maze_cols(const MazeGrid *g) {
+	return g->cols;
+}
+int maze_cell(const MazeGrid *g, int r, int c) {
+	return is_inside(g, r, c) ? grid_get(g, r, c) : CELL_WALL;
+}
+void maze_set_cell(MazeGrid *g, int r, int c, int v) {
+	if (!is_inside(g, r, c)) return;
+	grid_make_writable(g);
+	grid_set(g, r, c, (cell_t)v);
+	grid_touch(g);
+}
+int maze_mark(const MazeGrid *g, int r, int c) {
+	return is_inside(g, r, c) ? mark_get(g, r, c) : M_NONE;
+}
+void maze_clear_marks(MazeGrid *g) {
+	memset(g->marks, M_NONE, g->n);
+}
+int maze_grid_save(const MazeGrid *g, const char *path, unsigned long long seed, int gen, int packed) {
+	return maze_save(path, g, seed, gen < 0 ? GEN_NONE : (unsigned)gen, packed);
+}
+MazeGrid *maze_grid_load(const char *path, int verify, unsigned long long *seed, int *gen, const char **err) {
+	Grid *g = xmalloc(sizeof(Grid));
+	MazeInfo info;
+	const char *e = maze_load(path, g, &info, verify);
+	if (err) *err = e;
+	if (e) {
+		free(g);
+		return NULL;
+	}
+	if (seed) *seed = info.seed;
+	if (gen) *gen = info.gen < GEN_COUNT ? (int)info.gen : -1;
+	return g;
+}
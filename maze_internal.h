@@ -0,0 +1,455 @@
+/* maze_internal.h - what the libmaze modules share with each other and with
+   the programs built on top of them: the grid layout and accessors, memory,
+   threads, stats and the solver tables. Not part of the public API. */
+#ifndef MAZE_INTERNAL_H
+#define MAZE_INTERNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <signal.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <conio.h>
+#include <psapi.h>
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#include <termios.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/* outside the library, the internals are only reachable when linking it
+   statically */
+#ifndef MAZE_BUILD
+#define MAZE_STATIC
+#endif
+#include "maze.h"
+
+/* per-thread globals, so batch workers don't share solver state */
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/* PRNG (splitmix64) behind all randomness: per thread so batch workers
+   generate independently, and the same seed gives the same maze on every
+   platform, unlike rand() */
+extern THREAD_LOCAL unsigned long long rng_state;
+static inline unsigned long long splitmix64(unsigned long long *x) {
+	unsigned long long z = (*x += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+static inline void rng_seed(unsigned long long seed) {
+	rng_state = seed;
+}
+/* 0..INT_MAX, a drop-in for rand() */
+static inline int rng_int(void) {
+	return (int)(splitmix64(&rng_state) >> 33);
+}
+
+/* time, memory (abort on exhaustion) and the per-run scratch arena */
+double now_ms(void);
+void *xmalloc(size_t n);
+void *xcalloc(size_t n, size_t size);
+void *xrealloc(void *old, size_t n);
+extern THREAD_LOCAL unsigned long long alloc_count, alloc_bytes;
+void *scratch_alloc(size_t n);
+void scratch_reset(void);
+void scratch_free(void);
+long peak_rss_kb(void);
+
+/* instrumentation: operation counters and per-phase timers behind --stats,
+   compiled out entirely with -DMAZE_NO_STATS */
+enum { PH_GEN, PH_SEARCH, PH_RENDER, PH_SLEEP, PH_COUNT };
+#ifndef MAZE_NO_STATS
+extern const char *phase_names[PH_COUNT];
+typedef struct {
+	unsigned long long pushes, pops, neighbours, max_depth;
+	unsigned long long gens, solves, draws, draw_bytes;
+	double phase_ms[PH_COUNT];
+} Stats;
+extern THREAD_LOCAL Stats stats;
+void stats_merge(Stats *into, const Stats *from);
+#define STAT_ADD(field, n) (stats.field += (n))
+#define STAT_DEPTH(d) do { if ((unsigned long long)(d) > stats.max_depth) stats.max_depth = (d); } while (0)
+#else
+#define STAT_ADD(field, n) ((void)0)
+#define STAT_DEPTH(d) ((void)0)
+#endif
+void stats_sleep(int ms);
+
+/* portable threads */
+#define MAX_THREADS 64
+#if defined(_WIN32) || defined(_WIN64)
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION mutex_t;
+#else
+typedef pthread_t thread_t;
+typedef pthread_mutex_t mutex_t;
+#endif
+void thread_start(thread_t *t, void *(*fn)(void*), void *arg);
+void thread_join(thread_t t);
+int cpu_count(void);
+void mutex_init(mutex_t *m);
+void mutex_lock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+void mutex_destroy(mutex_t *m);
+
+
+/* cell_t: bit 0 is the wall flag, the high nibble holds the traversal cost
+   of an open cell (0 = default cost 1, otherwise 1..15) */
+typedef unsigned char cell_t;
+#define CELL_WALL MAZE_WALL
+#define CELL_COST_SHIFT MAZE_COST_SHIFT
+#define CELL_COST_MAX 15
+typedef unsigned char mark_t;
+#define M_NONE 0
+#define M_VISIT MAZE_VISIT
+#define M_FRONT MAZE_FRONT
+#define M_PATH MAZE_PATH
+#define M_CURSOR 8 /* wall editor cursor */
+
+/* cell storage order: row-major, or with -DMAZE_TILED 8x8 tiles stored one
+   after another (each tile is 64 contiguous bytes, a cache line), so the
+   vertical neighbours of most cells share a line. Code outside the accessors
+   below works on storage indices: build them with grid_index, take them
+   apart with grid_row/grid_col, and move between neighbours with grid_step.
+   Files, traces and images stay row-major in both builds. */
+#define TILE_SHIFT 3
+#define TILE (1 << TILE_SHIFT)
+
+typedef struct MazeGrid {
+	int rows, cols;
+	int n;            /* stored cells, rows*cols plus any tile padding */
+#ifdef MAZE_TILED
+	int tcols;        /* tiles per tile row */
+#endif
+	cell_t *cells;
+	mark_t *marks;
+	unsigned version; /* renewed (grid_touch) whenever cells change, for derived tables */
+	void *map;        /* file mapping cells point into (read-only), or NULL */
+	size_t map_len;
+} Grid;
+
+#ifdef MAZE_TILED
+static inline int grid_index(const Grid *g, int r, int c) {
+	return ((r >> TILE_SHIFT) * g->tcols + (c >> TILE_SHIFT)) << (2*TILE_SHIFT) |
+	       (r & (TILE-1)) << TILE_SHIFT | (c & (TILE-1));
+}
+static inline int grid_row(const Grid *g, int u) {
+	return (u >> (2*TILE_SHIFT)) / g->tcols << TILE_SHIFT | (u >> TILE_SHIFT & (TILE-1));
+}
+static inline int grid_col(const Grid *g, int u) {
+	return (u >> (2*TILE_SHIFT)) % g->tcols << TILE_SHIFT | (u & (TILE-1));
+}
+/* neighbour k (nbrs4 order) of an inner cell: inside a tile a step is
+   +-1 or +-TILE, crossing a tile edge it jumps to the next tile */
+static inline int grid_step(const Grid *g, int u, int k) {
+	const int row = (TILE-1) << TILE_SHIFT, band = g->tcols << (2*TILE_SHIFT);
+	switch (k) {
+	case 0: return u & row ? u - TILE : u - band + row;
+	case 1: return (u & row) != row ? u + TILE : u + band - row;
+	case 2: return u & (TILE-1) ? u - 1 : u - TILE*TILE + TILE-1;
+	default: return (u & (TILE-1)) != TILE-1 ? u + 1 : u + TILE*TILE - (TILE-1);
+	}
+}
+#else
+static inline int grid_index(const Grid *g, int r, int c) {
+	return r * g->cols + c;
+}
+static inline int grid_row(const Grid *g, int u) {
+	return u / g->cols;
+}
+static inline int grid_col(const Grid *g, int u) {
+	return u % g->cols;
+}
+static inline int grid_step(const Grid *g, int u, int k) {
+	return u + (k == 0 ? -g->cols : k == 1 ? g->cols : k == 2 ? -1 : 1);
+}
+#endif
+/* row-major cell number (files, traces) <-> storage index */
+static inline int grid_at(const Grid *g, int i) {
+#ifdef MAZE_TILED
+	return grid_index(g, i / g->cols, i % g->cols);
+#else
+	(void)g;
+	return i;
+#endif
+}
+static inline int grid_rm(const Grid *g, int u) {
+#ifdef MAZE_TILED
+	return grid_row(g, u) * g->cols + grid_col(g, u);
+#else
+	(void)g;
+	return u;
+#endif
+}
+
+static inline cell_t grid_get(const Grid *g, int r, int c) {
+	return g->cells[grid_index(g, r, c)];
+}
+static inline int cell_is_wall(cell_t v) {
+	return v & CELL_WALL;
+}
+static inline int cell_cost(cell_t v) {
+	int k = v >> CELL_COST_SHIFT;
+	return k ? k : 1;
+}
+static inline void grid_set(Grid *g, int r, int c, cell_t v) {
+	g->cells[grid_index(g, r, c)] = v;
+}
+static inline mark_t mark_get(const Grid *g, int r, int c) {
+	return g->marks[grid_index(g, r, c)];
+}
+static inline void mark_or(Grid *g, int r, int c, mark_t v) {
+	g->marks[grid_index(g, r, c)] |= v;
+}
+static inline void mark_andnot(Grid *g, int r, int c, mark_t v) {
+	g->marks[grid_index(g, r, c)] &= ~v;
+}
+static inline void mark_set(Grid *g, int r, int c, mark_t v) {
+	g->marks[grid_index(g, r, c)] = v;
+}
+
+static inline void shuffle_ints(int *arr, int n) {
+	for (int i = n-1; i > 0; --i) {
+		int j = rng_int() % (i+1);
+		int t = arr[i];
+		arr[i] = arr[j];
+		arr[j] = t;
+	}
+}
+
+/* helpers */
+static inline int is_inside(const Grid*g,int r,int c) {
+	return r>=0 && r<g->rows && c>=0 && c<g->cols;
+}
+static const int nbrs4[4][2] = {{-1,0},{1,0},{0,-1},{0,1}};
+
+/* bounds check for the slow path on grids without a wall ring */
+static inline int step_inside(const Grid *g, int u, int k) {
+	return is_inside(g, grid_row(g,u) + nbrs4[k][0], grid_col(g,u) + nbrs4[k][1]);
+}
+
+
+/* maze files, version 1 (all fields little-endian):
+     0  "MAZE"      4  u16 version   6  u16 header size (64)
+     8  u32 rows   12  u32 cols     16  u64 seed
+    24  u32 generator id (index into generators, GEN_NONE if edited)
+    28  u32 flags  32  u64 body offset   40  u64 body size
+    48  u32 FNV-1a checksum of the body, rest reserved (zero)
+   The body is either raw cell_t bytes, which the loader exposes straight
+   from the mapping, or (MF_PACKED) a wall bitplane, row-major LSB first,
+   followed by a cost nibble plane when MF_COSTS is set. */
+#define MF_VERSION 1
+#define MF_HEADER 64
+#define MF_PACKED 1
+#define MF_COSTS 2
+#define GEN_NONE 0xFFFFFFFFu
+
+typedef struct {
+	unsigned long long seed;
+	unsigned gen, flags, checksum;
+} MazeInfo;
+
+
+/* solver event trace: solvers append (cell, event) pairs as varints,
+   v = zigzag(cell - previous cell) << 2 | event, so nearby cells cost one or
+   two bytes. Every key_every events an EV_KEY record snapshots marks
+   (run-length coded) so replay can seek without decoding from the start.
+   File layout:
+     "MTRC" u16 version, u16 0, u32 rows, cols, sr, sc, er, ec, key_every,
+     u32 flags (MF_COSTS), packed cells (cells_pack), event stream,
+     key index: u32 count, count x (u64 event number, u64 offset),
+     u64 index offset, "MTRE" */
+enum { EV_FRONT, EV_VISIT, EV_PATH, EV_KEY };
+#define TRACE_VERSION 1
+#define TRACE_HEADER 40
+#define TRACE_KEY_MIN 4096
+#define TRACE_FLUSH 65536
+
+typedef struct {
+	FILE *f;              /* NULL keeps the whole trace in buf */
+	unsigned char *buf;
+	size_t len, cap, flushed;
+	long long events;
+	int last, key_every;
+	long long *keys;      /* event number, offset pairs */
+	int nkeys, keycap;
+	int failed;           /* a write failed; sticky until trace_close */
+} Trace;
+
+/* the marks a cell gets for a solver event */
+static inline mark_t mark_event(mark_t m, int ev) {
+	if (ev == EV_FRONT) return m | M_FRONT;
+	if (ev == EV_VISIT) return (m & ~M_FRONT) | M_VISIT;
+	return m | M_PATH;
+}
+
+/* grids and maze files */
+void grid_touch(Grid *g);
+void grid_init(Grid *g, int rows, int cols);
+void grid_free(Grid *g);
+void grid_make_writable(Grid *g);
+int grid_walled(const Grid *g);
+void grid_set_row(Grid *g, int r, const cell_t *row);
+void put_le(unsigned char *p, unsigned long long v, int n);
+unsigned long long get_le(const unsigned char *p, int n);
+size_t cells_packed_size(size_t n, int costs);
+int cells_have_costs(const cell_t *cells, size_t n);
+void cells_pack(const cell_t *cells, size_t n, int costs, unsigned char *out);
+void cells_unpack(const unsigned char *in, size_t n, int costs, cell_t *cells);
+cell_t *cells_rows(const Grid *g);
+void cells_rows_done(const Grid *g, cell_t *rows);
+void cells_from_rows(Grid *g, const cell_t *src);
+int maze_save(const char *path, const Grid *g, unsigned long long seed, unsigned gen, int packed);
+const char *maze_load(const char *path, Grid *g, MazeInfo *info, int verify);
+int map_file(const char *path, unsigned char **data, size_t *len);
+void unmap_file(void *data, size_t len);
+
+/* generators */
+#define GEN_COUNT MAZE_GEN_COUNT
+extern const char *gen_names[GEN_COUNT];
+void run_generator(int gen, Grid *g);
+
+/* solvers and their derived tables */
+#define ALGO_COUNT MAZE_ALGO_LAST
+extern const char *algo_names[ALGO_COUNT+1];
+typedef struct Heap Heap;
+typedef struct Hpa Hpa;
+
+#define DIST_NONE 0xFFFF
+#define ORACLE_MAX_CELLS 16384 /* n*n 16-bit entries: 512 MB at the limit */
+#define ALT_LANDMARKS 8
+
+typedef struct {
+	int n;              /* open cells */
+	int *id_of;         /* cell -> compact id, -1 for walls */
+	int *cell_of;       /* compact id -> cell */
+	unsigned short *d;  /* n*n step distances, DIST_NONE = unreachable */
+} DistOracle;
+
+/* ALT landmarks: open cells nearest to points spread around the border
+   (landmarks "behind" the targets give the tightest bounds), with a full
+   distance row per landmark */
+typedef struct {
+	int k, n;          /* landmarks, cells per row */
+	unsigned version;
+	int cells[ALT_LANDMARKS];
+	unsigned short *d; /* k * g->n */
+} Landmarks;
+
+/* JPS+ accelerator: per cell and direction (nbrs4 order) the distance to the
+   next goal-independent jump point (> 0), or minus the free run before a
+   wall (<= 0). Rebuilt only when the grid version changes. */
+typedef struct {
+	int *jd;
+	int rows, cols;
+	unsigned version;
+} JumpTable;
+
+#define LPA_INF (1 << 29)
+
+typedef struct {
+	Grid *g;
+	int s, t;      /* start and goal index */
+	int *gv, *rhs;
+	int *seq;      /* push order, newest first among equal keys */
+	unsigned pushes;
+	Heap *open;
+	long expanded; /* cells expanded by the last lpa_compute */
+} Lpa;
+
+void solver_clear(Grid *g);
+long run_solver(int algo, Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o);
+void solve_astar(Grid *g, int sr, int sc, int er, int ec);
+void solver_caches_free(void);
+DistOracle *oracle_build(const Grid *g, int nthreads);
+int oracle_dist(const DistOracle *o, int u, int v);
+void oracle_free(DistOracle *o);
+Landmarks *landmarks_build(const Grid *g, int k, int nthreads);
+void landmarks_free(Landmarks *L);
+extern THREAD_LOCAL Landmarks *alt_cache;
+extern THREAD_LOCAL int alt_threads;
+void jps_table_build(JumpTable *t, const Grid *g);
+extern THREAD_LOCAL JumpTable jps_cache;
+Lpa *lpa_create(Grid *g, int sr, int sc, int er, int ec);
+void lpa_free(Lpa *l);
+void lpa_compute(Lpa *l);
+void lpa_toggle(Lpa *l, const int *cells, int n);
+Hpa *hpa_create(Grid *g);
+void hpa_free(Hpa *h);
+void hpa_update(Hpa *h, int u);
+int hpa_query(Hpa *h, int s, int t, const MazeObserver *o);
+extern THREAD_LOCAL Hpa *hpa_cache;
+Hpa *hpa_cached(Grid *g);
+
+/* terminal view, overview and image output */
+enum { KEY_UP = 1000, KEY_DOWN, KEY_LEFT, KEY_RIGHT };
+#define VIEW_RESERVED 4 /* terminal lines left for the text under the maze */
+enum { RENDER_BLOCK, RENDER_HALF, RENDER_BRAILLE, RENDER_OVERVIEW, RENDER_COUNT };
+extern const char *render_names[RENDER_COUNT];
+
+typedef struct {
+	int mode;
+	int level;      /* overview pyramid level */
+	int top, left;  /* maze cell in the top-left corner */
+	int h, w;       /* visible cells */
+	int tr, tc;     /* terminal size */
+	int follow;
+	unsigned long long *prev; /* colours and glyph per screen character */
+	int ph, pw;     /* screen characters */
+	char *out;
+	size_t len, cap;
+} View;
+
+typedef struct Overview Overview;
+typedef struct Recorder Recorder;
+extern THREAD_LOCAL View view;
+extern THREAD_LOCAL int view_dirty;
+extern THREAD_LOCAL int view_focus;
+extern volatile sig_atomic_t term_resized;
+extern THREAD_LOCAL FILE *draw_sink;
+extern THREAD_LOCAL Overview *overview;
+void enable_ansi_on_windows(void);
+void clear_screen(void);
+void move_cursor_home(void);
+void hide_cursor(void);
+void show_cursor(void);
+void view_init(void);
+int view_pan(int key);
+void draw_grid(const Grid *g, int sr, int sc, int er, int ec);
+void render_release(void);
+void overview_drop(void);
+void overview_forget(const Grid *g);
+void overview_reset(Overview *o);
+void overview_mark(Overview *o, int u, mark_t before, mark_t after);
+int export_image(const Grid *g, int sr, int sc, int er, int ec, int scale, const char *path);
+Recorder *recorder_open(const char *path, const Grid *g, int every, int scale);
+void recorder_step(Recorder *rc, const Grid *g, int sr, int sc, int er, int ec);
+long recorder_close(Recorder *rc, const Grid *g, int sr, int sc, int er, int ec);
+
+/* solver event traces */
+Trace *trace_open(const char *path, Grid *g, int sr, int sc, int er, int ec);
+void trace_event(Trace *t, const Grid *g, int u, int ev);
+int trace_close(Trace *t, size_t *size);
+
+#endif
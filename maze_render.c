@@ -0,0 +1,824 @@
+/* maze_render.c - ANSI terminal view, overview, image export and GIF recorder */
+
+#include "maze_internal.h"
+
+/* enable ANSI on Windows */
+void enable_ansi_on_windows(void) {
+#if defined(_WIN32) || defined(_WIN64)
+	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (hOut == INVALID_HANDLE_VALUE) return;
+	DWORD dwMode = 0;
+	if (!GetConsoleMode(hOut, &dwMode)) return;
+	dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+	SetConsoleMode(hOut, dwMode);
+	SetConsoleOutputCP(CP_UTF8); /* half block and braille glyphs */
+#endif
+}
+
+/* terminal helpers */
+THREAD_LOCAL int view_dirty = 1; /* the screen no longer shows the last frame */
+void clear_screen(void) {
+	printf("\x1b[2J");
+	view_dirty = 1;
+}
+void move_cursor_home(void) {
+	printf("\x1b[H");
+}
+void hide_cursor(void) {
+	printf("\x1b[?25l");
+}
+void show_cursor(void) {
+	printf("\x1b[?25h");
+}
+/* visible terminal size in characters */
+#if defined(_WIN32) || defined(_WIN64)
+static int term_size(int *rows, int *cols) {
+	CONSOLE_SCREEN_BUFFER_INFO ci;
+	if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ci)) return -1;
+	*rows = ci.srWindow.Bottom - ci.srWindow.Top + 1;
+	*cols = ci.srWindow.Right - ci.srWindow.Left + 1;
+	return 0;
+}
+#else
+static int term_size(int *rows, int *cols) {
+	struct winsize ws;
+	if (ioctl(1, TIOCGWINSZ, &ws) || !ws.ws_row || !ws.ws_col) return -1;
+	*rows = ws.ws_row;
+	*cols = ws.ws_col;
+	return 0;
+}
+#endif
+
+/* colors & blocks */
+#define COL_RESET "\x1b[0m"
+#define COL_WALL  "\x1b[48;2;20;28;36m"
+#define COL_EMPTY "\x1b[48;2;240;245;250m"
+#define COL_VISIT "\x1b[48;2;16;185;129m"
+#define COL_FRONT "\x1b[48;2;96;165;250m"
+#define COL_PATH  "\x1b[48;2;244;63;94m"
+#define COL_SE    "\x1b[48;2;251;191;36m"
+#define COL_CURSOR "\x1b[48;2;168;85;247m"
+#define FULL_BLOCK "  "
+/* most expensive terrain shade (cheap cells use COL_EMPTY) */
+#define COSTLY_R 133
+#define COSTLY_G 94
+#define COSTLY_B 60
+
+
+/* cell colours: draw_grid prints pal_ansi, the image writers use pal_rgb */
+enum { PAL_WALL, PAL_EMPTY, PAL_VISIT, PAL_FRONT, PAL_PATH, PAL_SE, PAL_CURSOR, PAL_COUNT };
+static const char *pal_ansi[PAL_COUNT] = { COL_WALL, COL_EMPTY, COL_VISIT, COL_FRONT, COL_PATH, COL_SE, COL_CURSOR };
+static const unsigned char pal_rgb[PAL_COUNT][3] = {
+	{20,28,36}, {240,245,250}, {16,185,129}, {96,165,250}, {244,63,94}, {251,191,36}, {168,85,247}
+};
+
+static int cell_color(const Grid *g, int r, int c, int sr, int sc, int er, int ec) {
+	mark_t m = mark_get(g,r,c);
+	if (m & M_CURSOR) return PAL_CURSOR;
+	if ((r==sr && c==sc) || (r==er && c==ec)) return PAL_SE;
+	if (cell_is_wall(grid_get(g,r,c))) return PAL_WALL;
+	if (m & M_PATH) return PAL_PATH;
+	if (m & M_FRONT) return PAL_FRONT;
+	if (m & M_VISIT) return PAL_VISIT;
+	return PAL_EMPTY;
+}
+/* weighted cells shade from COL_EMPTY towards COSTLY_* */
+static void cost_shade(cell_t cell, unsigned char rgb[3]) {
+	static const int costly[3] = { COSTLY_R, COSTLY_G, COSTLY_B };
+	int t = cell_cost(cell) - 1, n = CELL_COST_MAX - 1;
+	for (int i=0; i<3; i++) rgb[i] = (unsigned char)((pal_rgb[PAL_EMPTY][i]*(n-t) + costly[i]*t) / n);
+}
+
+/* overview: per-block counts of open, visited, frontier and path cells in
+   a pyramid of levels with 8x8, 16x16, ... cell blocks. Solver marks
+   update one block per level, so the overview of a 10k x 10k solve costs
+   the terminal's size per frame, not the maze's. */
+#define OV_BASE_SHIFT 3
+#define OV_SHADES 8 /* visited fraction steps, keeps frame diffs small */
+typedef struct {
+	unsigned open, visit, front, path;
+} OvBlock;
+struct Overview {
+	const Grid *g;
+	unsigned version;
+	int rows, cols, nlevels;
+	int br[32], bc[32]; /* blocks per level */
+	OvBlock *level[32];
+};
+
+THREAD_LOCAL Overview *overview; /* only kept while the overview is shown */
+
+void overview_drop(void) {
+	if (!overview) return;
+	for (int i=0; i<overview->nlevels; i++) free(overview->level[i]);
+	free(overview);
+	overview = NULL;
+}
+
+void overview_forget(const Grid *g) {
+	if (overview && overview->g == g) overview_drop();
+}
+
+static void overview_sync(const Grid *g) {
+	if (overview && overview->g == g && overview->version == g->version &&
+	    overview->rows == g->rows && overview->cols == g->cols) return;
+	overview_drop();
+	Overview *o = xcalloc(1, sizeof(Overview));
+	o->g = g;
+	o->version = g->version;
+	o->rows = g->rows;
+	o->cols = g->cols;
+	for (int i=0; ; i++) {
+		int side = 1 << (OV_BASE_SHIFT + i);
+		o->br[i] = (g->rows + side-1) / side;
+		o->bc[i] = (g->cols + side-1) / side;
+		o->level[i] = xcalloc((size_t)o->br[i] * o->bc[i], sizeof(OvBlock));
+		o->nlevels = i+1;
+		if (o->br[i] == 1 && o->bc[i] == 1) break;
+	}
+	for (int r=0; r<g->rows; r++) {
+		OvBlock *row = o->level[0] + (size_t)(r >> OV_BASE_SHIFT) * o->bc[0];
+		for (int c=0; c<g->cols; c++) {
+			mark_t m = mark_get(g,r,c);
+			OvBlock *b = row + (c >> OV_BASE_SHIFT);
+			b->open += !cell_is_wall(grid_get(g,r,c));
+			b->visit += (m & M_VISIT) != 0;
+			b->front += (m & M_FRONT) != 0;
+			b->path += (m & M_PATH) != 0;
+		}
+	}
+	for (int i=1; i<o->nlevels; i++) {
+		for (int r=0; r<o->br[i-1]; r++) {
+			for (int c=0; c<o->bc[i-1]; c++) {
+				OvBlock *a = &o->level[i-1][(size_t)r*o->bc[i-1] + c], *b = &o->level[i][(size_t)(r/2)*o->bc[i] + c/2];
+				b->open += a->open;
+				b->visit += a->visit;
+				b->front += a->front;
+				b->path += a->path;
+			}
+		}
+	}
+	overview = o;
+}
+
+/* a solve starts: nothing is marked any more */
+void overview_reset(Overview *o) {
+	for (int i=0; i<o->nlevels; i++) {
+		OvBlock *b = o->level[i];
+		for (size_t j=0, n=(size_t)o->br[i]*o->bc[i]; j<n; j++) b[j].visit = b[j].front = b[j].path = 0;
+	}
+}
+
+void overview_mark(Overview *o, int u, mark_t before, mark_t after) {
+	int dv = ((after & M_VISIT) != 0) - ((before & M_VISIT) != 0);
+	int df = ((after & M_FRONT) != 0) - ((before & M_FRONT) != 0);
+	int dp = ((after & M_PATH) != 0) - ((before & M_PATH) != 0);
+	if (!dv && !df && !dp) return;
+	int r = grid_row(o->g, u), c = grid_col(o->g, u);
+	for (int i=0; i<o->nlevels; i++) {
+		OvBlock *b = &o->level[i][(size_t)(r >> (OV_BASE_SHIFT+i)) * o->bc[i] + (c >> (OV_BASE_SHIFT+i))];
+		b->visit += dv;
+		b->front += df;
+		b->path += dp;
+	}
+}
+
+/* colour key of one block, as cell_key; out of range draws as wall */
+static unsigned overview_key(const Overview *o, int level, int r, int c) {
+	if (r >= o->br[level] || c >= o->bc[level]) return PAL_WALL;
+	const OvBlock *b = &o->level[level][(size_t)r*o->bc[level] + c];
+	if (!b->open) return PAL_WALL;
+	if (b->path) return PAL_PATH;
+	if (b->front) return PAL_FRONT;
+	int t = (int)((unsigned long long)b->visit * OV_SHADES / b->open);
+	if (!t) return PAL_EMPTY;
+	if (t >= OV_SHADES) return PAL_VISIT;
+	unsigned key = 0x80000000u;
+	for (int i=0; i<3; i++) key |= (unsigned)((pal_rgb[PAL_EMPTY][i]*(OV_SHADES-t) + pal_rgb[PAL_VISIT][i]*t) / OV_SHADES) << (16 - 8*i);
+	return key;
+}
+
+/* viewport: draw_grid shows the window of the maze that fits the terminal,
+   keeping the solver's latest cell in view unless the user has panned.
+   Frames are diffed against the previous one and only changed characters
+   are sent, with colour escapes only where the colour changes.
+   Render modes trade colour detail for area: a block is one cell in two
+   columns, a half block two cells stacked (fg over bg) in one column, and
+   a braille character 2x4 cells with a dot per open cell, coloured by the
+   most important mark among them. The overview fits the whole maze, one
+   pyramid block per half character. */
+const char *render_names[RENDER_COUNT] = { "block", "half", "braille", "overview" };
+static const struct {
+	int sx, sy, cw; /* cells per character across and down, columns per character */
+} render_geom[RENDER_COUNT] = { {1,1,2}, {1,2,1}, {2,4,1}, {1,2,1} };
+
+/* view state is per thread like the solver tables; the terminal, and so
+   term_resized, is shared */
+THREAD_LOCAL View view = { RENDER_BLOCK, 0, 0, 0, 0, 0, 0, 0, 1, NULL, 0, 0, NULL, 0, 0 };
+THREAD_LOCAL int view_focus = -1; /* last cell a solver marked, -1 = none */
+volatile sig_atomic_t term_resized = 1;
+THREAD_LOCAL FILE *draw_sink; /* NULL = stdout */
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static void on_winch(int sig) {
+	(void)sig;
+	term_resized = 1;
+}
+#endif
+void view_init(void) {
+#if !defined(_WIN32) && !defined(_WIN64)
+	struct sigaction sa;
+	memset(&sa, 0, sizeof sa);
+	sa.sa_handler = on_winch;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGWINCH, &sa, NULL);
+#endif
+}
+
+/* arrows/hjkl pan a quarter screen and stop following, f follows again,
+   m cycles the render mode */
+int view_pan(int key) {
+	int dr = 0, dc = 0;
+	if (key == KEY_UP || key == 'k') dr = -1;
+	else if (key == KEY_DOWN || key == 'j') dr = 1;
+	else if (key == KEY_LEFT || key == 'h') dc = -1;
+	else if (key == KEY_RIGHT || key == 'l') dc = 1;
+	else if (key == 'f' || key == 'F') {
+		view.follow = 1;
+		return 1;
+	} else if (key == 'm' || key == 'M') {
+		view.mode = (view.mode + 1) % RENDER_COUNT;
+		if (view.mode != RENDER_OVERVIEW) overview_drop();
+		view_dirty = 1;
+		return 1;
+	} else return 0;
+	view.follow = 0;
+	view.top += dr * (view.h/4 > 1 ? view.h/4 : 1);
+	view.left += dc * (view.w/4 > 1 ? view.w/4 : 1);
+	return 1;
+}
+
+static void view_fit(const Grid *g) {
+	if (term_resized) {
+		if (term_size(&view.tr, &view.tc)) { /* not a terminal: the whole maze */
+			view.tr = g->rows + VIEW_RESERVED;
+			view.tc = 2 * g->cols;
+		}
+		view_dirty = 1;
+#if !defined(_WIN32) && !defined(_WIN64)
+		term_resized = 0; /* windows has no resize signal, so it asks every frame */
+#endif
+	}
+	int sx = render_geom[view.mode].sx, sy = render_geom[view.mode].sy, cw = render_geom[view.mode].cw;
+	int lines = view.tr - VIEW_RESERVED > 1 ? view.tr - VIEW_RESERVED : 1;
+	int chars = view.tc / cw > 1 ? view.tc / cw : 1;
+	int h = lines * sy, w = chars * sx;
+	if (view.mode == RENDER_OVERVIEW) { /* the finest level that fits, pyramid blocks for cells */
+		overview_sync(g);
+		for (view.level = 0; view.level < overview->nlevels-1; view.level++)
+			if (overview->br[view.level] <= h && overview->bc[view.level] <= w) break;
+		h = overview->br[view.level];
+		w = overview->bc[view.level];
+	}
+	view.h = h < g->rows ? h : g->rows;
+	view.w = w < g->cols ? w : g->cols;
+	h = view.h;
+	w = view.w;
+	if (view.follow && view.mode != RENDER_OVERVIEW && view_focus >= 0 && view_focus < g->n) {
+		int fr = grid_row(g, view_focus), fc = grid_col(g, view_focus);
+		if (fr < view.top + h/4 || fr >= view.top + h - h/4) view.top = fr - h/2;
+		if (fc < view.left + w/4 || fc >= view.left + w - w/4) view.left = fc - w/2;
+	}
+	if (view.top > g->rows - h) view.top = g->rows - h;
+	if (view.left > g->cols - w) view.left = g->cols - w;
+	if (view.top < 0) view.top = 0;
+	if (view.left < 0 || view.mode == RENDER_OVERVIEW) view.left = 0;
+	if (view.mode == RENDER_OVERVIEW) view.top = 0;
+	int ph = (h + sy-1) / sy, pw = (w + sx-1) / sx;
+	if (ph != view.ph || pw != view.pw) {
+		view.prev = xrealloc(view.prev, sizeof(unsigned long long) * ph * pw);
+		view.ph = ph;
+		view.pw = pw;
+		view_dirty = 1;
+	}
+}
+
+/* frees the calling thread's view buffers and overview */
+void render_release(void) {
+	overview_drop();
+	free(view.prev);
+	free(view.out);
+	view.prev = NULL;
+	view.out = NULL;
+	view.ph = view.pw = 0;
+	view.len = view.cap = 0;
+}
+
+static void view_put(const char *s, size_t n) {
+	if (view.len + n > view.cap) {
+		while (view.len + n > view.cap) view.cap = view.cap ? view.cap*2 : 65536;
+		view.out = xrealloc(view.out, view.cap);
+	}
+	memcpy(view.out + view.len, s, n);
+	view.len += n;
+}
+
+/* colour key: a palette index, or 0x80000000 | rgb for weighted cells;
+   cells past the edge draw as wall */
+static unsigned cell_key(const Grid *g, int r, int c, int sr, int sc, int er, int ec) {
+	if (r >= g->rows || c >= g->cols) return PAL_WALL;
+	int k = cell_color(g, r, c, sr, sc, er, ec);
+	cell_t cell = grid_get(g,r,c);
+	if (k == PAL_EMPTY && (cell >> CELL_COST_SHIFT)) {
+		unsigned char rgb[3];
+		cost_shade(cell, rgb);
+		return 0x80000000u | (unsigned)rgb[0] << 16 | rgb[1] << 8 | rgb[2];
+	}
+	return (unsigned)k;
+}
+static void view_colour(int fg, unsigned key) {
+	char esc[32];
+	int r, gr, b;
+	if (key & 0x80000000u) {
+		r = key >> 16 & 0xFF;
+		gr = key >> 8 & 0xFF;
+		b = key & 0xFF;
+	} else if (!fg) {
+		view_put(pal_ansi[key], strlen(pal_ansi[key]));
+		return;
+	} else {
+		r = pal_rgb[key][0];
+		gr = pal_rgb[key][1];
+		b = pal_rgb[key][2];
+	}
+	view_put(esc, snprintf(esc, sizeof esc, "\x1b[%d;2;%d;%d;%dm", fg ? 38 : 48, r, gr, b));
+}
+
+/* draw */
+void draw_grid(const Grid *g, int sr, int sc, int er, int ec) {
+	static const unsigned char braille_bit[4][2] = { {0x01,0x08}, {0x02,0x10}, {0x04,0x20}, {0x40,0x80} };
+	char esc[48];
+	unsigned cur_fg = 0xFFFFFFFFu, cur_bg = 0xFFFFFFFFu;
+	int cr = -1, cc = -1;
+#ifndef MAZE_NO_STATS
+	double t0 = now_ms();
+#endif
+	view_fit(g);
+	view.len = 0;
+	if (view_dirty) { /* after a clear, resize or mode change nothing on screen can be trusted */
+		memset(view.prev, 0xFF, sizeof(unsigned long long) * view.ph * view.pw);
+		view_put("\x1b[2J", 4);
+		view_dirty = 0;
+	}
+	int mode = view.mode, sx = render_geom[mode].sx, sy = render_geom[mode].sy, cw = render_geom[mode].cw;
+	for (int vr=0; vr<view.ph; vr++) {
+		for (int vc=0; vc<view.pw; vc++) {
+			int r = view.top + vr*sy, c = view.left + vc*sx;
+			unsigned fg = 0, bg;
+			unsigned long long key;
+			unsigned char glyph[4] = { ' ', ' ' };
+			int glen = 2;
+			if (mode == RENDER_BLOCK) {
+				bg = cell_key(g, r, c, sr, sc, er, ec);
+				key = bg;
+			} else if (mode == RENDER_HALF || mode == RENDER_OVERVIEW) {
+				if (mode == RENDER_HALF) {
+					fg = cell_key(g, r, c, sr, sc, er, ec);
+					bg = cell_key(g, r+1, c, sr, sc, er, ec);
+				} else {
+					fg = overview_key(overview, view.level, r, c);
+					bg = overview_key(overview, view.level, r+1, c);
+				}
+				key = (unsigned long long)fg << 32 | bg;
+				memcpy(glyph, "\xe2\x96\x80", 3); /* U+2580 upper half block */
+				glen = 3;
+			} else {
+				int dots = 0, best = -1;
+				bg = PAL_WALL;
+				for (int dr=0; dr<4; dr++) {
+					for (int dc=0; dc<2; dc++) {
+						unsigned k = cell_key(g, r+dr, c+dc, sr, sc, er, ec);
+						if (k == PAL_WALL) continue;
+						dots |= braille_bit[dr][dc];
+						int rank = k & 0x80000000u ? PAL_EMPTY : (int)k; /* palette order is importance */
+						if (rank > best) {
+							best = rank;
+							fg = k;
+						}
+					}
+				}
+				key = (unsigned long long)fg << 32 | (unsigned)dots;
+				glyph[0] = 0xE2; /* U+2800 + dots */
+				glyph[1] = (unsigned char)(0xA0 | dots >> 6);
+				glyph[2] = (unsigned char)(0x80 | (dots & 0x3F));
+				glen = 3;
+			}
+			unsigned long long *p = &view.prev[vr*view.pw + vc];
+			if (*p == key) continue;
+			*p = key;
+			if (vr != cr || vc != cc) view_put(esc, snprintf(esc, sizeof esc, "\x1b[%d;%dH", vr+1, cw*vc+1));
+			if (mode != RENDER_BLOCK && fg != cur_fg) {
+				view_colour(1, fg);
+				cur_fg = fg;
+			}
+			if (bg != cur_bg) {
+				view_colour(0, bg);
+				cur_bg = bg;
+			}
+			view_put((const char*)glyph, glen);
+			cr = vr;
+			cc = vc + 1;
+		}
+	}
+	/* leave the cursor on a cleared line under the maze, as callers print there */
+	view_put(esc, snprintf(esc, sizeof esc, "%s\x1b[%d;1H\x1b[J", COL_RESET, view.ph + 1));
+	FILE *out = draw_sink ? draw_sink : stdout;
+	fwrite(view.out, 1, view.len, out);
+	fflush(out);
+#ifndef MAZE_NO_STATS
+	stats.draws++;
+	stats.draw_bytes += view.len;
+	stats.phase_ms[PH_RENDER] += now_ms() - t0;
+#endif
+}
+
+
+/* image export, streamed one cell row at a time so memory stays O(width).
+   PNG output carries its own deflate: each scanline gets the Sub or Up
+   filter (whichever leaves smaller residuals), which turns flat colour runs
+   and repeated rows into zero runs, and those are coded as distance-1
+   matches in a single fixed-Huffman block. */
+#define PNG_CHUNK 65536
+
+typedef struct {
+	FILE *f;
+	unsigned char buf[PNG_CHUNK]; /* pending IDAT payload */
+	int len;
+	unsigned long bits;           /* deflate bit buffer, LSB first */
+	int nbits;
+	int prev, run;                /* last literal and its pending repeats */
+	unsigned adler_a, adler_b;
+} PngOut;
+
+static THREAD_LOCAL unsigned crc_table[256];
+static unsigned crc32_update(unsigned crc, const unsigned char *p, size_t n) {
+	if (!crc_table[1]) {
+		for (unsigned i=0; i<256; i++) {
+			unsigned c = i;
+			for (int k=0; k<8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			crc_table[i] = c;
+		}
+	}
+	for (size_t i=0; i<n; i++) crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+static void png_chunk(FILE *f, const char *type, const unsigned char *data, int len) {
+	unsigned char be[4] = { len >> 24, len >> 16, len >> 8, len };
+	fwrite(be, 1, 4, f);
+	fwrite(type, 1, 4, f);
+	fwrite(data, 1, len, f);
+	unsigned crc = crc32_update(crc32_update(0xFFFFFFFFu, (const unsigned char*)type, 4), data, len) ^ 0xFFFFFFFFu;
+	unsigned char cb[4] = { crc >> 24, crc >> 16, crc >> 8, crc };
+	fwrite(cb, 1, 4, f);
+}
+static void png_byte(PngOut *p, unsigned char b) {
+	p->buf[p->len++] = b;
+	if (p->len == PNG_CHUNK) {
+		png_chunk(p->f, "IDAT", p->buf, p->len);
+		p->len = 0;
+	}
+}
+static void png_bits(PngOut *p, unsigned v, int n) {
+	p->bits |= (unsigned long)v << p->nbits;
+	p->nbits += n;
+	while (p->nbits >= 8) {
+		png_byte(p, p->bits & 0xFF);
+		p->bits >>= 8;
+		p->nbits -= 8;
+	}
+}
+/* fixed-Huffman literal/length symbol; Huffman codes go out MSB first */
+static void png_sym(PngOut *p, int sym) {
+	int code, len;
+	if (sym < 144) code = 0x30 + sym, len = 8;
+	else if (sym < 256) code = 0x190 + sym - 144, len = 9;
+	else if (sym < 280) code = sym - 256, len = 7;
+	else code = 0xC0 + sym - 280, len = 8;
+	int rev = 0;
+	for (int i=0; i<len; i++) rev |= ((code >> i) & 1) << (len-1-i);
+	png_bits(p, rev, len);
+}
+static void png_match(PngOut *p, int len) {
+	static const short base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+	static const unsigned char extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+	int k = 28;
+	while (base[k] > len) k--;
+	png_sym(p, 257 + k);
+	png_bits(p, len - base[k], extra[k]);
+	png_bits(p, 0, 5); /* distance code 0: distance 1 */
+}
+static void png_flush_run(PngOut *p) {
+	if (p->run >= 3) png_match(p, p->run);
+	else for (int i=0; i<p->run; i++) png_sym(p, p->prev);
+	p->run = 0;
+}
+static void png_data(PngOut *p, const unsigned char *d, int n) {
+	for (int i=0; i<n; i++) {
+		p->adler_a = (p->adler_a + d[i]) % 65521;
+		p->adler_b = (p->adler_b + p->adler_a) % 65521;
+		if (d[i] == p->prev) {
+			if (++p->run == 258) png_flush_run(p);
+			continue;
+		}
+		png_flush_run(p);
+		png_sym(p, d[i]);
+		p->prev = d[i];
+	}
+}
+
+static void cell_rgb(const Grid *g, int r, int c, int sr, int sc, int er, int ec, unsigned char rgb[3]) {
+	int k = cell_color(g, r, c, sr, sc, er, ec);
+	if (k == PAL_EMPTY && (grid_get(g,r,c) >> CELL_COST_SHIFT)) cost_shade(grid_get(g,r,c), rgb);
+	else memcpy(rgb, pal_rgb[k], 3);
+}
+
+/* writes the grid and its marks with scale x scale pixels per cell, as PNG
+   when path ends in ".png" and binary PPM otherwise; returns 0 on success */
+int export_image(const Grid *g, int sr, int sc, int er, int ec, int scale, const char *path) {
+	if (scale < 1) scale = 1;
+	size_t plen = strlen(path);
+	int png = plen >= 4 && !strcmp(path + plen - 4, ".png");
+	long w = (long)g->cols * scale, h = (long)g->rows * scale;
+	if (w > 0x7FFFFFFF / 3 || h > 0x7FFFFFFF) return -1;
+	FILE *f = fopen(path, "wb");
+	if (!f) return -1;
+	/* row: the current scanline; for PNG prev/filt hold the previous
+	   scanline and the candidate filtered line (filter type byte first) */
+	unsigned char *row = xmalloc(3*w), *prev = NULL, *filt = NULL;
+	PngOut *p = NULL;
+	if (png) {
+		prev = xcalloc(3*w, 1);
+		filt = xmalloc(2 * (3*w + 1));
+		p = xcalloc(1, sizeof(PngOut));
+	}
+	if (!row || (png && (!prev || !filt || !p))) {
+		fclose(f);
+		free(row);
+		free(prev);
+		free(filt);
+		free(p);
+		return -1;
+	}
+	if (png) {
+		static const unsigned char sig[8] = { 137,'P','N','G',13,10,26,10 };
+		unsigned char ihdr[13] = { w >> 24, w >> 16, w >> 8, w, h >> 24, h >> 16, h >> 8, h, 8, 2, 0, 0, 0 };
+		fwrite(sig, 1, 8, f);
+		png_chunk(f, "IHDR", ihdr, 13);
+		p->f = f;
+		p->prev = -1;
+		p->adler_a = 1;
+		png_byte(p, 0x78); /* zlib header: deflate, 32K window */
+		png_byte(p, 0x01);
+		png_bits(p, 1, 1); /* BFINAL */
+		png_bits(p, 1, 2); /* BTYPE = fixed Huffman */
+	} else fprintf(f, "P6\n%ld %ld\n255\n", w, h);
+
+	for (int r=0; r<g->rows; r++) {
+		for (int c=0; c<g->cols; c++) {
+			unsigned char rgb[3];
+			cell_rgb(g, r, c, sr, sc, er, ec, rgb);
+			for (int x=0; x<scale; x++) memcpy(row + 3*((long)c*scale + x), rgb, 3);
+		}
+		for (int y=0; y<scale; y++) {
+			if (!png) {
+				fwrite(row, 1, 3*w, f);
+				continue;
+			}
+			unsigned char *sub = filt, *up = filt + 3*w + 1;
+			long cost_sub = 0, cost_up = 0;
+			sub[0] = 1;
+			up[0] = 2;
+			for (long i=0; i<3*w; i++) {
+				sub[i+1] = row[i] - (i >= 3 ? row[i-3] : 0);
+				up[i+1] = row[i] - prev[i];
+				cost_sub += sub[i+1] < 128 ? sub[i+1] : 256 - sub[i+1];
+				cost_up += up[i+1] < 128 ? up[i+1] : 256 - up[i+1];
+			}
+			png_data(p, cost_up <= cost_sub ? up : sub, 3*w + 1);
+			memcpy(prev, row, 3*w);
+		}
+	}
+
+	if (png) {
+		png_flush_run(p);
+		png_sym(p, 256); /* end of block */
+		if (p->nbits) png_bits(p, 0, 8 - p->nbits);
+		unsigned adler = p->adler_b << 16 | p->adler_a;
+		for (int i=3; i>=0; i--) png_byte(p, adler >> (8*i));
+		if (p->len) png_chunk(f, "IDAT", p->buf, p->len);
+		png_chunk(f, "IEND", NULL, 0);
+	}
+	int err = ferror(f);
+	if (fclose(f)) err = 1;
+	free(row);
+	free(prev);
+	free(filt);
+	free(p);
+	return err ? -1 : 0;
+}
+
+
+/* solver progress recorder: every `every` animation steps the grid is
+   captured, headless and at full solver speed, either as a frame of an
+   animated GIF (palette = the COL_* colours, and only the rectangle that
+   changed since the last frame is encoded) or as a numbered PPM/PNG file */
+#define GIF_FRAME_CS 4 /* frame delay, 1/100 s */
+#define LZW_HASH 5003
+
+struct Recorder {
+	FILE *gif;               /* NULL when writing numbered frames */
+	const char *pattern;     /* printf pattern for numbered frames */
+	int every, scale;
+	long steps, frames;
+	int rows, cols;
+	unsigned char *prev;     /* palette index per cell in the last frame */
+	unsigned char *px;       /* frame pixels */
+	/* LZW output state and string table */
+	int hkey[LZW_HASH];
+	short hcode[LZW_HASH];
+	unsigned char block[255];
+	int blen, nbits;
+	unsigned long bits;
+};
+
+static void gif_code(Recorder *rc, int code, int size) {
+	rc->bits |= (unsigned long)code << rc->nbits;
+	rc->nbits += size;
+	while (rc->nbits >= 8) {
+		rc->block[rc->blen++] = rc->bits & 0xFF;
+		rc->bits >>= 8;
+		rc->nbits -= 8;
+		if (rc->blen == 255) {
+			fputc(255, rc->gif);
+			fwrite(rc->block, 1, 255, rc->gif);
+			rc->blen = 0;
+		}
+	}
+}
+
+/* GIF flavoured LZW: variable code size up to 12 bits, clear when full */
+static void gif_lzw(Recorder *rc, const unsigned char *px, size_t n, int min_size) {
+	int *hkey = rc->hkey;
+	short *hcode = rc->hcode;
+	int clear = 1 << min_size, size = min_size + 1, next = clear + 1;
+	for (int i=0; i<LZW_HASH; i++) hkey[i] = -1;
+	fputc(min_size, rc->gif);
+	rc->blen = rc->nbits = 0;
+	rc->bits = 0;
+	gif_code(rc, clear, size);
+	int cur = px[0];
+	for (size_t i=1; i<n; i++) {
+		int key = cur << 8 | px[i], h = key % LZW_HASH;
+		while (hkey[h] >= 0 && hkey[h] != key) h = (h + 1) % LZW_HASH;
+		if (hkey[h] == key) {
+			cur = hcode[h];
+			continue;
+		}
+		gif_code(rc, cur, size);
+		hkey[h] = key;
+		hcode[h] = (short)++next;
+		if (next >= (1 << size)) size++;
+		if (next == 4095) {
+			gif_code(rc, clear, size);
+			for (int j=0; j<LZW_HASH; j++) hkey[j] = -1;
+			size = min_size + 1;
+			next = clear + 1;
+		}
+		cur = px[i];
+	}
+	gif_code(rc, cur, size);
+	/* the decoder adds an entry for the last code too, and may widen */
+	if (next + 1 >= (1 << size) && size < 12) size++;
+	gif_code(rc, clear + 1, size);
+	if (rc->nbits) gif_code(rc, 0, 8 - rc->nbits);
+	if (rc->blen) {
+		fputc(rc->blen, rc->gif);
+		fwrite(rc->block, 1, rc->blen, rc->gif);
+	}
+	fputc(0, rc->gif);
+}
+
+/* 1 when a frame pattern holds exactly one int conversion (%d, %05d, ...)
+   and no other % than %%, so it is safe to hand to snprintf */
+static int frame_pattern_ok(const char *s) {
+	int convs = 0;
+	for (; *s; s++) {
+		if (*s != '%') continue;
+		if (*++s == '%') continue;
+		while (*s && strchr("-+ #0", *s)) s++;
+		while (isdigit((unsigned char)*s)) s++;
+		if (*s == '.')
+			for (s++; isdigit((unsigned char)*s); s++) ;
+		if (*s != 'd' && *s != 'i') return 0;
+		convs++;
+	}
+	return convs == 1;
+}
+
+/* path ending in ".gif" records an animation, anything else is a printf
+   pattern for numbered frames (e.g. frame_%05d.ppm); NULL on failure */
+Recorder *recorder_open(const char *path, const Grid *g, int every, int scale) {
+	size_t plen = strlen(path);
+	int gif = plen >= 4 && !strcmp(path + plen - 4, ".gif");
+	if (scale < 1) scale = 1;
+	if (gif && ((long)g->cols*scale > 65535 || (long)g->rows*scale > 65535)) return NULL;
+	if (!gif && !frame_pattern_ok(path)) return NULL;
+	Recorder *rc = xcalloc(1, sizeof(Recorder));
+	rc->every = every > 0 ? every : 1;
+	rc->scale = scale;
+	rc->rows = g->rows;
+	rc->cols = g->cols;
+	if (!gif) {
+		rc->pattern = path;
+		return rc;
+	}
+	rc->gif = fopen(path, "wb");
+	rc->prev = xmalloc((size_t)g->rows * g->cols);
+	rc->px = xmalloc((size_t)g->rows * g->cols * scale * scale);
+	if (!rc->gif || !rc->prev || !rc->px) {
+		if (rc->gif) fclose(rc->gif);
+		free(rc->prev);
+		free(rc->px);
+		free(rc);
+		return NULL;
+	}
+	int w = g->cols*scale, h = g->rows*scale;
+	unsigned char hdr[13] = { 'G','I','F','8','9','a', w & 0xFF, w >> 8, h & 0xFF, h >> 8, 0xF2, 0, 0 };
+	fwrite(hdr, 1, 13, rc->gif);
+	for (int i=0; i<8; i++) {
+		static const unsigned char black[3];
+		fwrite(i < PAL_COUNT ? pal_rgb[i] : black, 1, 3, rc->gif);
+	}
+	static const unsigned char loop[19] = { 0x21,0xFF,11,'N','E','T','S','C','A','P','E','2','.','0',3,1,0,0,0 };
+	fwrite(loop, 1, 19, rc->gif);
+	return rc;
+}
+
+static void recorder_capture(Recorder *rc, const Grid *g, int sr, int sc, int er, int ec) {
+	if (!rc->gif) {
+		char name[1024];
+		snprintf(name, sizeof(name), rc->pattern, (int)rc->frames++);
+		export_image(g, sr, sc, er, ec, rc->scale, name);
+		return;
+	}
+	/* bounding box of the cells whose colour changed */
+	int r0 = g->rows, r1 = -1, c0 = g->cols, c1 = -1;
+	for (int r=0; r<g->rows; r++) for (int c=0; c<g->cols; c++) {
+		unsigned char k = (unsigned char)cell_color(g, r, c, sr, sc, er, ec);
+		unsigned char *p = &rc->prev[r*g->cols + c];
+		if (rc->frames && *p == k) continue;
+		*p = k;
+		if (r < r0) r0 = r;
+		if (r > r1) r1 = r;
+		if (c < c0) c0 = c;
+		if (c > c1) c1 = c;
+	}
+	if (r1 < 0) return;
+	rc->frames++;
+	int s = rc->scale, w = (c1-c0+1)*s, h = (r1-r0+1)*s;
+	for (int y=0; y<h; y++) for (int x=0; x<w; x++)
+		rc->px[(size_t)y*w + x] = rc->prev[(r0 + y/s)*g->cols + c0 + x/s];
+	int left = c0*s, top = r0*s;
+	unsigned char gce[8] = { 0x21, 0xF9, 4, 0x04, GIF_FRAME_CS, 0, 0, 0 }; /* disposal: keep */
+	unsigned char desc[10] = { 0x2C, left & 0xFF, left >> 8, top & 0xFF, top >> 8, w & 0xFF, w >> 8, h & 0xFF, h >> 8, 0 };
+	fwrite(gce, 1, 8, rc->gif);
+	fwrite(desc, 1, 10, rc->gif);
+	gif_lzw(rc, rc->px, (size_t)w*h, 3);
+}
+
+void recorder_step(Recorder *rc, const Grid *g, int sr, int sc, int er, int ec) {
+	if (rc->steps++ % rc->every == 0) recorder_capture(rc, g, sr, sc, er, ec);
+}
+
+/* captures the final state and closes the file; returns frames written */
+long recorder_close(Recorder *rc, const Grid *g, int sr, int sc, int er, int ec) {
+	recorder_capture(rc, g, sr, sc, er, ec);
+	long frames = rc->frames;
+	if (rc->gif) {
+		fputc(0x3B, rc->gif);
+		fclose(rc->gif);
+	}
+	free(rc->prev);
+	free(rc->px);
+	free(rc);
+	return frames;
+}
+
+
+int maze_export_image(const MazeGrid *g, int sr, int sc, int er, int ec, int scale, const char *path) {
+	return export_image(g, sr, sc, er, ec, scale < 1 ? 1 : scale, path);
+}
+void maze_render_ansi(const MazeGrid *g, int sr, int sc, int er, int ec) {
+	draw_grid(g, sr, sc, er, ec);
+}
@@ -0,0 +1,1409 @@
+/* maze_solve.c - path solvers and their data structures */
+
+#include "maze_internal.h"
+
+/* small data structures: a stack and a queue of cell indices kept in
+   fixed-size chunks, added as they fill. Emptied chunks go back to a
+   per-thread pool, so memory follows the frontier rather than the grid and
+   repeated searches stop allocating. */
+#define CHUNK_CELLS 1024
+typedef struct Chunk {
+	struct Chunk *next;
+	unsigned v[CHUNK_CELLS];
+} Chunk;
+static THREAD_LOCAL Chunk *chunk_pool;
+static Chunk *chunk_get(void) {
+	Chunk *k = chunk_pool;
+	if (k) chunk_pool = k->next;
+	else k = xmalloc(sizeof(Chunk));
+	k->next = NULL;
+	return k;
+}
+static void chunk_put(Chunk *k) {
+	k->next = chunk_pool;
+	chunk_pool = k;
+}
+static void chunk_pool_free(void) {
+	while (chunk_pool) {
+		Chunk *k = chunk_pool;
+		chunk_pool = k->next;
+		free(k);
+	}
+}
+
+typedef struct {
+	Chunk *top; /* newest chunk, linked to older ones */
+	int n;      /* entries used in top */
+	long size;
+} Stack;
+static Stack *stack_create(void) {
+	Stack*s=scratch_alloc(sizeof(Stack));
+	s->top=NULL;
+	s->n=CHUNK_CELLS;
+	s->size=0;
+	return s;
+}
+static void stack_push(Stack*s, unsigned v) {
+	if (s->n == CHUNK_CELLS) {
+		Chunk *k = chunk_get();
+		k->next = s->top;
+		s->top = k;
+		s->n = 0;
+	}
+	s->top->v[s->n++] = v;
+	s->size++;
+	STAT_ADD(pushes, 1);
+	STAT_DEPTH(s->size);
+}
+static unsigned stack_pop(Stack*s) {
+	if (s->n == 0) {
+		Chunk *k = s->top;
+		s->top = k->next;
+		chunk_put(k);
+		s->n = CHUNK_CELLS;
+	}
+	s->size--;
+	STAT_ADD(pops, 1);
+	return s->top->v[--s->n];
+}
+static int stack_empty(const Stack*s) {
+	return s->size==0;
+}
+static void stack_free(Stack*s) {
+	while (s->top) {
+		Chunk *k = s->top;
+		s->top = k->next;
+		chunk_put(k);
+	}
+}
+
+typedef struct {
+	Chunk *head, *tail; /* pop from head, push to tail */
+	int hi, ti;         /* next read slot in head, next write slot in tail */
+	long size;
+} Queue;
+static Queue* queue_create(void) {
+	Queue*q=scratch_alloc(sizeof(Queue));
+	q->head=q->tail=chunk_get();
+	q->hi=q->ti=0;
+	q->size=0;
+	return q;
+}
+static void queue_push(Queue*q, unsigned v) {
+	if (q->ti == CHUNK_CELLS) {
+		q->tail->next = chunk_get();
+		q->tail = q->tail->next;
+		q->ti = 0;
+	}
+	q->tail->v[q->ti++] = v;
+	q->size++;
+	STAT_ADD(pushes, 1);
+	STAT_DEPTH(q->size);
+}
+static unsigned queue_pop(Queue*q) {
+	if (q->hi == CHUNK_CELLS) {
+		Chunk *k = q->head;
+		q->head = k->next;
+		chunk_put(k);
+		q->hi = 0;
+	}
+	q->size--;
+	STAT_ADD(pops, 1);
+	return q->head->v[q->hi++];
+}
+static int queue_empty(const Queue*q) {
+	return q->size==0;
+}
+static void queue_free(Queue*q) {
+	while (q->head) {
+		Chunk *k = q->head;
+		q->head = k->next;
+		chunk_put(k);
+	}
+}
+
+/* Dial's bucket queue: keys are distances and an edge adds at most
+   BQ_SPAN-1, so pending keys always fit in BQ_SPAN circular buckets.
+   Push/pop are O(1) and a full run is O(N + C) instead of O(N log N). */
+#define BQ_SPAN 32
+typedef struct {
+	int *data;
+	int len, cap;
+} Bucket;
+typedef struct {
+	Bucket b[BQ_SPAN];
+	int cur, count;
+} BucketQueue;
+static BucketQueue *bq_create(void) {
+	BucketQueue*q=xcalloc(1,sizeof(BucketQueue));
+	return q;
+}
+static void bq_push(BucketQueue*q, int key, int v) {
+	Bucket *b = &q->b[key & (BQ_SPAN-1)];
+	if (b->len == b->cap) {
+		b->cap = b->cap ? b->cap*2 : 64;
+		b->data = xrealloc(b->data, sizeof(int)*b->cap);
+	}
+	b->data[b->len++] = v;
+	q->count++;
+	STAT_ADD(pushes, 1);
+	STAT_DEPTH(q->count);
+}
+/* pops an entry with the smallest key; stale entries are left for the caller
+   to skip (lazy decrease-key) */
+static int bq_pop(BucketQueue*q, int *key) {
+	while (q->b[q->cur & (BQ_SPAN-1)].len == 0) q->cur++;
+	Bucket *b = &q->b[q->cur & (BQ_SPAN-1)];
+	q->count--;
+	STAT_ADD(pops, 1);
+	*key = q->cur;
+	return b->data[--b->len];
+}
+static int bq_empty(const BucketQueue*q) {
+	return q->count==0;
+}
+static void bq_free(BucketQueue*q) {
+	for (int i=0; i<BQ_SPAN; i++) free(q->b[i].data);
+	free(q);
+}
+
+/* binary min-heap for searches whose key steps are unbounded (JPS) */
+typedef struct {
+	long long key;
+	int v;
+} HeapItem;
+struct Heap {
+	HeapItem *data;
+	int len, cap;
+};
+static Heap *heap_create(int cap) {
+	Heap*h=xmalloc(sizeof(Heap));
+	h->data=xmalloc(sizeof(HeapItem)*cap);
+	h->len=0;
+	h->cap=cap;
+	return h;
+}
+static void heap_push(Heap*h, long long key, int v) {
+	if (h->len == h->cap) {
+		h->cap *= 2;
+		h->data = xrealloc(h->data, sizeof(HeapItem)*h->cap);
+	}
+	STAT_ADD(pushes, 1);
+	STAT_DEPTH(h->len + 1);
+	int i = h->len++;
+	while (i > 0 && h->data[(i-1)/2].key > key) {
+		h->data[i] = h->data[(i-1)/2];
+		i = (i-1)/2;
+	}
+	h->data[i] = (HeapItem) {
+		key, v
+	};
+}
+static int heap_pop(Heap*h, long long *key) {
+	HeapItem top = h->data[0], last = h->data[--h->len];
+	int i = 0;
+	STAT_ADD(pops, 1);
+	for (;;) {
+		int k = 2*i + 1;
+		if (k >= h->len) break;
+		if (k+1 < h->len && h->data[k+1].key < h->data[k].key) k++;
+		if (h->data[k].key >= last.key) break;
+		h->data[i] = h->data[k];
+		i = k;
+	}
+	h->data[i] = last;
+	if (key) *key = top.key;
+	return top.v;
+}
+static int heap_empty(const Heap*h) {
+	return h->len==0;
+}
+static void heap_free(Heap*h) {
+	free(h->data);
+	free(h);
+}
+
+
+/* observers: solvers take the observer of the solve as their last argument.
+   Each solver body is force-inlined into two copies (see SOLVER below): a
+   watched one, and a headless one where the observer is a constant NULL so
+   every notification and the branch around it compile away. */
+#if defined(_MSC_VER)
+#define ALWAYS_INLINE __forceinline
+#else
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
+/* path cells marked by the solve running on this thread */
+static THREAD_LOCAL long path_cells;
+
+/* solvers start from clear marks */
+void solver_clear(Grid *g) {
+	memset(g->marks, M_NONE, g->n);
+}
+
+/* every mark a solver makes goes through here so observers can follow it */
+static ALWAYS_INLINE void solver_mark(Grid *g, int u, int ev, const MazeObserver *o) {
+	mark_t before = g->marks[u];
+	g->marks[u] = mark_event(before, ev);
+	path_cells += ev == EV_PATH && !(before & M_PATH);
+	if (!o) return;
+	void (*fn)(void*, const MazeGrid*, int, int) = ev == EV_FRONT ? o->on_frontier : ev == EV_VISIT ? o->on_visit : o->on_path;
+	if (fn) fn(o->ctx, g, grid_rm(g, u), before);
+}
+
+/* reconstruct path using parent[] (only if parent set) */
+static ALWAYS_INLINE void reconstruct_and_mark(Grid *g, int *parent, int er, int ec, const MazeObserver *o) {
+	int idx = grid_index(g, er, ec);
+	if (parent[idx] == -1) return; /* no path */
+	for (int cur = idx; cur != -2 && cur != -1; cur = parent[cur])
+		solver_mark(g, cur, EV_PATH, o);
+}
+
+/* BFS and DFS keep one state byte per cell instead of reading cells, marks
+   and an int parent array: the M_VISIT/M_FRONT/M_PATH bits as in marks,
+   the wall bit, and the nbrs4 direction back to the parent, so the inner
+   loop touches a single array. Headless, marks are written in one pass at
+   the end instead of per step. */
+#define ST_MARKS (M_VISIT | M_FRONT | M_PATH)
+#define ST_WALL 8
+#define ST_BACK_SHIFT 4
+
+
+static void state_fill(const Grid *g, unsigned char *st) {
+	for (int i=0; i<g->n; i++) st[i] = cell_is_wall(g->cells[i]) ? ST_WALL : 0;
+}
+static unsigned char *state_create(const Grid *g) {
+	unsigned char *st = scratch_alloc(g->n);
+	state_fill(g, st);
+	return st;
+}
+
+static ALWAYS_INLINE void state_mark(Grid *g, unsigned char *st, int u, int ev, const MazeObserver *o) {
+	st[u] = (st[u] & ~ST_MARKS) | mark_event(st[u] & ST_MARKS, ev);
+	if (o) solver_mark(g, u, ev, o);
+}
+
+/* marks the path back from the goal if it was reached and publishes the
+   marks */
+static ALWAYS_INLINE void state_finish(Grid *g, unsigned char *st, int s, int er, int ec, const MazeObserver *o) {
+	int goal = grid_index(g, er, ec);
+	if (st[goal] & (M_FRONT | M_VISIT)) {
+		for (int u = goal; ; u = grid_step(g, u, st[u] >> ST_BACK_SHIFT & 3)) {
+			state_mark(g, st, u, EV_PATH, o);
+			if (!o) path_cells++;
+			if (u == s) break;
+		}
+	}
+	if (!o) for (int i=0; i<g->n; i++) g->marks[i] = st[i] & ST_MARKS;
+}
+
+/* BFS - shortest path */
+static ALWAYS_INLINE void solve_bfs(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	if (o) solver_clear(g);
+	unsigned char *st = state_create(g);
+
+	Queue *q = queue_create();
+	int walled = grid_walled(g), s = grid_index(g, sr, sc), goal = grid_index(g, er, ec);
+	queue_push(q, s);
+	state_mark(g, st, s, EV_FRONT, o);
+
+	while (!queue_empty(q)) {
+		int u = queue_pop(q);
+		if (!(st[u] & M_VISIT)) {
+			state_mark(g, st, u, EV_VISIT, o);
+		}
+		if (u == goal) break;
+		STAT_ADD(neighbours, 4);
+		for (int k=0; k<4; k++) {
+			int v = grid_step(g, u, k);
+			if (!walled && !step_inside(g, u, k)) continue;
+			if (!(st[v] & (ST_WALL | M_FRONT | M_VISIT))) { /* parent set only once, when discovered */
+				st[v] |= (k ^ 1) << ST_BACK_SHIFT;
+				queue_push(q, v);
+				state_mark(g, st, v, EV_FRONT, o);
+			}
+		}
+	}
+	queue_free(q);
+	state_finish(g, st, s, er, ec, o);
+}
+
+/* DFS iterative - parent set only when discovered (prevents wrong overwrites) */
+static ALWAYS_INLINE void solve_dfs(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	if (o) solver_clear(g);
+	unsigned char *st = state_create(g);
+
+	Stack *stk = stack_create();
+	int walled = grid_walled(g), s = grid_index(g, sr, sc), goal = grid_index(g, er, ec);
+	stack_push(stk, s);
+	state_mark(g, st, s, EV_FRONT, o);
+
+	while (!stack_empty(stk)) {
+		int u = stack_pop(stk);
+
+		if (!(st[u] & M_VISIT)) {
+			state_mark(g, st, u, EV_VISIT, o);
+		}
+		if (u == goal) break;
+
+		int order[4] = {0,1,2,3};
+		shuffle_ints(order,4);
+		STAT_ADD(neighbours, 4);
+		for (int i=0; i<4; i++) {
+			int k = order[i], v = grid_step(g, u, k);
+			if (!walled && !step_inside(g, u, k)) continue;
+			if (!(st[v] & (ST_WALL | M_FRONT | M_VISIT))) {
+				st[v] |= (k ^ 1) << ST_BACK_SHIFT;
+				stack_push(stk, v);
+				state_mark(g, st, v, EV_FRONT, o);
+			}
+		}
+	}
+
+	stack_free(stk);
+	state_finish(g, st, s, er, ec, o);
+}
+
+/* multi-source, multi-target BFS: one sweep from every source at once, so
+   each cell is discovered from its nearest source (unit steps, terrain costs
+   ignored). Target cells carry ST_TARGET; the sweep stops at the first one
+   discovered (MAZE_STOP_ANY) or once all are (MAZE_STOP_ALL), and without
+   targets covers everything reachable. Sources carry ST_SOURCE instead of a
+   back direction, so the path to any discovered cell is the walk back to
+   one. The state bytes outlive the call for per-target path extraction. */
+#define ST_SOURCE 64
+#define ST_TARGET 128
+
+struct MazeMulti {
+	const Grid *g;
+	unsigned char *st;
+	int reached;
+};
+
+static ALWAYS_INLINE long multi_sweep(Grid *g, unsigned char *st, const int *src, int ns, const int *tgt, int nt,
+                                      int stop, int *reached, const MazeObserver *o) {
+	if (o) solver_clear(g);
+	int walled = grid_walled(g), pending = 0, found = 0;
+	for (int i=0; i<nt; i++)
+		if (!(st[tgt[i]] & (ST_WALL | ST_TARGET))) {
+			st[tgt[i]] |= ST_TARGET;
+			pending++;
+		}
+	Queue *q = queue_create();
+	for (int i=0; i<ns; i++) {
+		int u = src[i];
+		if (st[u] & (ST_WALL | M_FRONT)) continue;
+		st[u] |= ST_SOURCE;
+		queue_push(q, u);
+		state_mark(g, st, u, EV_FRONT, o);
+		found += (st[u] & ST_TARGET) != 0;
+	}
+	while (!queue_empty(q) && !(nt && (stop == MAZE_STOP_ANY ? found > 0 : found == pending))) {
+		int u = queue_pop(q);
+		state_mark(g, st, u, EV_VISIT, o);
+		STAT_ADD(neighbours, 4);
+		for (int k=0; k<4; k++) {
+			int v = grid_step(g, u, k);
+			if (!walled && !step_inside(g, u, k)) continue;
+			if (!(st[v] & (ST_WALL | M_FRONT | M_VISIT))) {
+				st[v] |= (k ^ 1) << ST_BACK_SHIFT;
+				queue_push(q, v);
+				state_mark(g, st, v, EV_FRONT, o);
+				found += (st[v] & ST_TARGET) != 0;
+			}
+		}
+	}
+	queue_free(q);
+
+	/* paths of the reached targets; shared stretches are marked once */
+	long path = 0;
+	for (int i=0; i<nt; i++) {
+		if (!(st[tgt[i]] & (M_FRONT | M_VISIT))) continue;
+		for (int u = tgt[i]; !(st[u] & M_PATH); u = grid_step(g, u, st[u] >> ST_BACK_SHIFT & 3)) {
+			state_mark(g, st, u, EV_PATH, o);
+			path++;
+			if (st[u] & ST_SOURCE) break;
+		}
+	}
+	if (!o) for (int i=0; i<g->n; i++) g->marks[i] = st[i] & ST_MARKS;
+	*reached = found;
+	return path;
+}
+
+static long multi_sweep_watched(Grid *g, unsigned char *st, const int *src, int ns, const int *tgt, int nt,
+                                int stop, int *reached, const MazeObserver *o) {
+	return multi_sweep(g, st, src, ns, tgt, nt, stop, reached, o);
+}
+static long multi_sweep_headless(Grid *g, unsigned char *st, const int *src, int ns, const int *tgt, int nt,
+                                 int stop, int *reached) {
+	return multi_sweep(g, st, src, ns, tgt, nt, stop, reached, NULL);
+}
+
+/* row-major cells -> storage indices, dropping cells outside the grid */
+static int multi_cells(const Grid *g, const int *cells, int n, int *out) {
+	int k = 0;
+	for (int i=0; i<n; i++)
+		if (cells[i] >= 0 && cells[i] < g->rows * g->cols) out[k++] = grid_at(g, cells[i]);
+	return k;
+}
+
+MazeMulti *maze_search_multi(MazeGrid *g, const int *sources, int nsources, const int *targets, int ntargets, int stop,
+                             const MazeObserver *o) {
+	MazeMulti *m = xmalloc(sizeof(MazeMulti));
+	m->g = g;
+	m->st = xmalloc(g->n);
+	state_fill(g, m->st);
+	int *src = scratch_alloc(sizeof(int) * (nsources > 0 ? nsources : 1));
+	int *tgt = scratch_alloc(sizeof(int) * (ntargets > 0 ? ntargets : 1));
+	int ns = multi_cells(g, sources, nsources, src), nt = multi_cells(g, targets, ntargets, tgt);
+	long path;
+#ifndef MAZE_NO_STATS
+	double t0 = now_ms(), inner = stats.phase_ms[PH_RENDER] + stats.phase_ms[PH_SLEEP];
+#endif
+	if (o) path = multi_sweep_watched(g, m->st, src, ns, tgt, nt, stop, &m->reached, o);
+	else path = multi_sweep_headless(g, m->st, src, ns, tgt, nt, stop, &m->reached);
+#ifndef MAZE_NO_STATS
+	inner = stats.phase_ms[PH_RENDER] + stats.phase_ms[PH_SLEEP] - inner;
+	stats.phase_ms[PH_SEARCH] += now_ms() - t0 - inner;
+	stats.solves++;
+#endif
+	scratch_reset();
+	if (o && o->on_done) o->on_done(o->ctx, g, path);
+	return m;
+}
+
+int maze_multi_reached(const MazeMulti *m) {
+	return m->reached;
+}
+
+/* steps from the nearest source to cell, -1 if the sweep did not reach it;
+   the first cap cells of the path (source first) go to path */
+long maze_multi_path(const MazeMulti *m, int cell, int *path, long cap) {
+	const Grid *g = m->g;
+	if (cell < 0 || cell >= g->rows * g->cols) return -1;
+	int t = grid_at(g, cell);
+	if (!(m->st[t] & (M_FRONT | M_VISIT))) return -1;
+	long steps = 0;
+	for (int u = t; !(m->st[u] & ST_SOURCE); u = grid_step(g, u, m->st[u] >> ST_BACK_SHIFT & 3)) steps++;
+	long i = steps;
+	for (int u = t; ; u = grid_step(g, u, m->st[u] >> ST_BACK_SHIFT & 3), i--) {
+		if (i < cap) path[i] = grid_rm(g, u);
+		if (m->st[u] & ST_SOURCE) break;
+	}
+	return steps;
+}
+
+void maze_multi_free(MazeMulti *m) {
+	if (!m) return;
+	free(m->st);
+	free(m);
+}
+
+/* Dijkstra - cheapest path on weighted terrain, cost = sum of entered cells */
+static ALWAYS_INLINE void solve_dijkstra(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	int *parent = scratch_alloc(sizeof(int)*g->n);
+	int *dist = scratch_alloc(sizeof(int)*g->n);
+	for (int i=0; i<g->n; i++) {
+		parent[i] = -1;
+		dist[i] = INT_MAX;
+	}
+	solver_clear(g);
+
+	BucketQueue *q = bq_create();
+	int s = grid_index(g, sr, sc);
+	bq_push(q, 0, s);
+	dist[s] = 0;
+	parent[s] = -2;
+	solver_mark(g, s, EV_FRONT, o);
+
+	while (!bq_empty(q)) {
+		int d, cur = bq_pop(q, &d);
+		if (d != dist[cur]) continue; /* superseded by a cheaper push */
+		int r = grid_row(g, cur), c = grid_col(g, cur);
+		solver_mark(g, cur, EV_VISIT, o);
+		if (r==er && c==ec) break;
+		STAT_ADD(neighbours, 4);
+		for (int k=0; k<4; k++) {
+			int nr=r + nbrs4[k][0], nc = c + nbrs4[k][1];
+			if (!is_inside(g,nr,nc)) continue;
+			int v = grid_index(g, nr, nc);
+			cell_t cell = g->cells[v];
+			int nd = d + cell_cost(cell);
+			if (!cell_is_wall(cell) && nd < dist[v]) {
+				dist[v] = nd;
+				parent[v] = cur;
+				bq_push(q, nd, v);
+				solver_mark(g, v, EV_FRONT, o);
+			}
+		}
+	}
+	reconstruct_and_mark(g, parent, er, ec, o);
+	bq_free(q);
+}
+
+/* distance oracle: unit-step BFS distances from many sources, one headless
+   BFS per source spread over threads. A full all-pairs matrix over compact
+   open-cell ids suits small mazes; landmark rows (ALT) scale to any size. */
+
+typedef struct {
+	const Grid *g;
+	const int *id_of;      /* cell -> column in a row, NULL = cell index */
+	int width;             /* entries per row */
+	const int *sources;    /* cell index per row */
+	int nsources;
+	unsigned short *rows;  /* nsources * width */
+	int nthreads;
+} BfsSweep;
+typedef struct {
+	BfsSweep *w;
+	int first; /* this thread takes sources first, first+nthreads, ... */
+} BfsSweepPart;
+
+static void *bfs_sweep_worker(void *arg) {
+	BfsSweep *w = ((BfsSweepPart*)arg)->w;
+	const Grid *g = w->g;
+	int *queue = xmalloc(sizeof(int)*g->n);
+	for (int si = ((BfsSweepPart*)arg)->first; si < w->nsources; si += w->nthreads) {
+		unsigned short *row = w->rows + (size_t)si * w->width;
+		for (int i=0; i<w->width; i++) row[i] = DIST_NONE;
+		int head = 0, tail = 0, s = w->sources[si];
+		row[w->id_of ? w->id_of[s] : s] = 0;
+		queue[tail++] = s;
+		while (head < tail) {
+			int u = queue[head++], r = grid_row(g, u), c = grid_col(g, u);
+			unsigned short d = row[w->id_of ? w->id_of[u] : u];
+			for (int k=0; k<4; k++) {
+				int nr = r + nbrs4[k][0], nc = c + nbrs4[k][1];
+				if (!is_inside(g,nr,nc)) continue;
+				int v = grid_index(g, nr, nc);
+				if (cell_is_wall(g->cells[v])) continue;
+				unsigned short *dv = &row[w->id_of ? w->id_of[v] : v];
+				if (*dv == DIST_NONE) {
+					*dv = d < DIST_NONE-1 ? d+1 : DIST_NONE-1;
+					queue[tail++] = v;
+				}
+			}
+		}
+	}
+	free(queue);
+	return NULL;
+}
+
+static void bfs_sweep(BfsSweep *w, int nthreads) {
+	thread_t tid[MAX_THREADS];
+	BfsSweepPart part[MAX_THREADS];
+	if (nthreads < 1) nthreads = 1;
+	if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+	w->nthreads = nthreads;
+	for (int i=0; i<nthreads; i++) {
+		part[i].w = w;
+		part[i].first = i;
+		if (i) thread_start(&tid[i], bfs_sweep_worker, &part[i]);
+	}
+	bfs_sweep_worker(&part[0]);
+	for (int i=1; i<nthreads; i++) thread_join(tid[i]);
+}
+
+
+/* NULL when the maze has more than ORACLE_MAX_CELLS open cells */
+DistOracle *oracle_build(const Grid *g, int nthreads) {
+	int cells = g->n, n = 0;
+	for (int i=0; i<cells; i++) n += !cell_is_wall(g->cells[i]);
+	if (n > ORACLE_MAX_CELLS) return NULL;
+	DistOracle *o = xmalloc(sizeof(DistOracle));
+	o->n = n;
+	o->id_of = xmalloc(sizeof(int)*cells);
+	o->cell_of = xmalloc(sizeof(int)*(n ? n : 1));
+	o->d = xmalloc(sizeof(unsigned short)*(size_t)n*n + 1);
+	for (int i=0; i<cells; i++) o->id_of[i] = -1;
+	for (int r=0, k=0; r<g->rows; r++) for (int c=0; c<g->cols; c++) { /* ids in row-major order */
+		int i = grid_index(g, r, c);
+		if (!cell_is_wall(g->cells[i])) {
+			o->id_of[i] = k;
+			o->cell_of[k++] = i;
+		}
+	}
+	BfsSweep w = { g, o->id_of, n, o->cell_of, n, o->d, 0 };
+	bfs_sweep(&w, nthreads);
+	return o;
+}
+/* steps between two open cells, DIST_NONE if disconnected */
+int oracle_dist(const DistOracle *o, int u, int v) {
+	return o->d[(size_t)o->id_of[u] * o->n + o->id_of[v]];
+}
+void oracle_free(DistOracle *o) {
+	free(o->id_of);
+	free(o->cell_of);
+	free(o->d);
+	free(o);
+}
+
+
+Landmarks *landmarks_build(const Grid *g, int k, int nthreads) {
+	int rows = g->rows, cols = g->cols;
+	Landmarks *L = xcalloc(1, sizeof(Landmarks));
+	if (k > ALT_LANDMARKS) k = ALT_LANDMARKS;
+	L->n = g->n;
+	L->version = g->version;
+	int perim = 2*(rows + cols);
+	for (int i=0; i<k; i++) {
+		/* point i along the perimeter, then the nearest open cell to it */
+		int p = (int)((long)perim * i / k), pr, pc;
+		if (p < cols) pr = 0, pc = p;
+		else if ((p -= cols) < rows) pr = p, pc = cols-1;
+		else if ((p -= rows) < cols) pr = rows-1, pc = cols-1-p;
+		else pr = rows-1-(p-cols), pc = 0;
+		int best = -1, bd = INT_MAX;
+		for (int r=0; r<rows; r++) for (int c=0; c<cols; c++) {
+			int d = abs(r - pr) + abs(c - pc);
+			if (d < bd && !cell_is_wall(grid_get(g,r,c))) bd = d, best = grid_index(g, r, c);
+		}
+		int dup = best < 0;
+		for (int j=0; j<L->k; j++) dup |= L->cells[j] == best;
+		if (!dup) L->cells[L->k++] = best;
+	}
+	L->d = xmalloc(sizeof(unsigned short)*(size_t)L->k*g->n + 1);
+	BfsSweep w = { g, NULL, g->n, L->cells, L->k, L->d, 0 };
+	bfs_sweep(&w, nthreads);
+	return L;
+}
+/* admissible and consistent: |d(L,t) - d(L,u)| <= steps(u,t) <= cost(u,t) */
+static int landmarks_bound(const Landmarks *L, int u, int t) {
+	int best = 0;
+	for (int i=0; i<L->k; i++) {
+		const unsigned short *row = L->d + (size_t)i * L->n;
+		if (row[u] == DIST_NONE || row[t] == DIST_NONE) continue;
+		int b = abs((int)row[t] - (int)row[u]);
+		if (b > best) best = b;
+	}
+	return best;
+}
+void landmarks_free(Landmarks *L) {
+	free(L->d);
+	free(L);
+}
+
+/* A* - Dijkstra ordered by cost + a lower bound (Manhattan distance, or the
+   ALT landmark bound when larger). Both bounds change by at most 1 per step,
+   so with costs >= 1 f grows by at most cost+1 per edge and the bucket
+   queue still applies */
+static int astar_h(const Grid *g, const Landmarks *alt, int u, int t) {
+	int h = abs(grid_row(g,u) - grid_row(g,t)) + abs(grid_col(g,u) - grid_col(g,t));
+	if (alt) {
+		int b = landmarks_bound(alt, u, t);
+		if (b > h) h = b;
+	}
+	return h;
+}
+
+static ALWAYS_INLINE void astar_search(Grid *g, int sr, int sc, int er, int ec, const Landmarks *alt, const MazeObserver *o) {
+	int *parent = scratch_alloc(sizeof(int)*g->n);
+	int *dist = scratch_alloc(sizeof(int)*g->n);
+	for (int i=0; i<g->n; i++) {
+		parent[i] = -1;
+		dist[i] = INT_MAX;
+	}
+	solver_clear(g);
+
+	int s = grid_index(g, sr, sc), goal = grid_index(g, er, ec);
+	BucketQueue *q = bq_create();
+	q->cur = astar_h(g, alt, s, goal);
+	bq_push(q, q->cur, s);
+	dist[s] = 0;
+	parent[s] = -2;
+	solver_mark(g, s, EV_FRONT, o);
+
+	while (!bq_empty(q)) {
+		int f, cur = bq_pop(q, &f);
+		int r = grid_row(g, cur), c = grid_col(g, cur);
+		if (f != dist[cur] + astar_h(g, alt, cur, goal)) continue;
+		solver_mark(g, cur, EV_VISIT, o);
+		if (r==er && c==ec) break;
+		STAT_ADD(neighbours, 4);
+		for (int k=0; k<4; k++) {
+			int nr=r + nbrs4[k][0], nc = c + nbrs4[k][1];
+			if (!is_inside(g,nr,nc)) continue;
+			int v = grid_index(g, nr, nc);
+			cell_t cell = g->cells[v];
+			int nd = dist[cur] + cell_cost(cell);
+			if (!cell_is_wall(cell) && nd < dist[v]) {
+				dist[v] = nd;
+				parent[v] = cur;
+				bq_push(q, nd + astar_h(g, alt, v, goal), v);
+				solver_mark(g, v, EV_FRONT, o);
+			}
+		}
+	}
+	reconstruct_and_mark(g, parent, er, ec, o);
+	bq_free(q);
+}
+
+static ALWAYS_INLINE void solve_astar_with(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	astar_search(g, sr, sc, er, ec, NULL, o);
+}
+/* headless A*, for callers outside run_solver */
+void solve_astar(Grid *g, int sr, int sc, int er, int ec) {
+	astar_search(g, sr, sc, er, ec, NULL, NULL);
+}
+
+THREAD_LOCAL Landmarks *alt_cache;
+THREAD_LOCAL int alt_threads = 1; /* batch workers keep 1: no nested pools */
+
+static ALWAYS_INLINE void solve_alt(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	if (!alt_cache || alt_cache->version != g->version || alt_cache->n != g->n) {
+		if (alt_cache) landmarks_free(alt_cache);
+		alt_cache = landmarks_build(g, ALT_LANDMARKS, alt_threads);
+	}
+	astar_search(g, sr, sc, er, ec, alt_cache, o);
+}
+
+/* Jump Point Search for 4-connected grids (uniform cost, terrain weights are
+   ignored). Canonical paths move vertically first and branch horizontally:
+   a horizontal jump stops only at cells with a forced side neighbour, a
+   vertical jump also stops where a horizontal jump from it finds something. */
+static int jps_open(const Grid *g, int r, int c) {
+	return is_inside(g,r,c) && !cell_is_wall(grid_get(g,r,c));
+}
+static int jps_forced(const Grid *g, int r, int c, int dr, int dc) {
+	if (dc) return (jps_open(g,r-1,c) && !jps_open(g,r-1,c-dc)) ||
+		       (jps_open(g,r+1,c) && !jps_open(g,r+1,c-dc));
+	return (jps_open(g,r,c-1) && !jps_open(g,r-dr,c-1)) ||
+	       (jps_open(g,r,c+1) && !jps_open(g,r-dr,c+1));
+}
+
+/* next jump point from (r,c) moving (dr,dc), or -1 */
+static int jps_jump(const Grid *g, int r, int c, int dr, int dc, int er, int ec) {
+	for (;;) {
+		r += dr;
+		c += dc;
+		STAT_ADD(neighbours, 1);
+		if (!jps_open(g,r,c)) return -1;
+		if ((r==er && c==ec) || jps_forced(g,r,c,dr,dc)) return grid_index(g, r, c);
+		if (dr && (jps_jump(g,r,c,0,1,er,ec) >= 0 || jps_jump(g,r,c,0,-1,er,ec) >= 0))
+			return grid_index(g, r, c);
+	}
+}
+
+
+void jps_table_build(JumpTable *t, const Grid *g) {
+	int rows = g->rows, cols = g->cols;
+	if (t->rows != rows || t->cols != cols) {
+		free(t->jd);
+		t->jd = xmalloc(sizeof(int)*4*rows*cols);
+	}
+	t->rows = rows;
+	t->cols = cols;
+	t->version = g->version;
+	int *jd = t->jd;
+	/* horizontal runs first; vertical jump points depend on them */
+	for (int r=0; r<rows; r++) {
+		for (int c=cols-1; c>=0; c--) {
+			int n = (r*cols + c)*4 + 3, nc = c+1;
+			if (!jps_open(g,r,nc)) jd[n] = 0;
+			else if (jps_forced(g,r,nc,0,1)) jd[n] = 1;
+			else jd[n] = jd[n+4] > 0 ? jd[n+4]+1 : jd[n+4]-1;
+		}
+		for (int c=0; c<cols; c++) {
+			int n = (r*cols + c)*4 + 2, nc = c-1;
+			if (!jps_open(g,r,nc)) jd[n] = 0;
+			else if (jps_forced(g,r,nc,0,-1)) jd[n] = 1;
+			else jd[n] = jd[n-4] > 0 ? jd[n-4]+1 : jd[n-4]-1;
+		}
+	}
+	for (int c=0; c<cols; c++) {
+		for (int r=rows-1; r>=0; r--) {
+			int n = (r*cols + c)*4 + 1, nr = r+1, m = n + 4*cols;
+			if (!jps_open(g,nr,c)) jd[n] = 0;
+			else if (jps_forced(g,nr,c,1,0) || jd[m+1] > 0 || jd[m+2] > 0) jd[n] = 1;
+			else jd[n] = jd[m] > 0 ? jd[m]+1 : jd[m]-1;
+		}
+		for (int r=0; r<rows; r++) {
+			int n = (r*cols + c)*4 + 0, nr = r-1, m = n - 4*cols;
+			if (!jps_open(g,nr,c)) jd[n] = 0;
+			else if (jps_forced(g,nr,c,-1,0) || jd[m+2] > 0 || jd[m+3] > 0) jd[n] = 1;
+			else jd[n] = jd[m] > 0 ? jd[m]+1 : jd[m]-1;
+		}
+	}
+}
+
+/* same result as jps_jump, in O(1) from the table plus a goal check */
+static int jps_jump_table(const Grid *g, const JumpTable *t, int r, int c, int k, int er, int ec) {
+	int cols = t->cols, d = t->jd[(r*cols + c)*4 + k];
+	int reach = d > 0 ? d : -d;
+	int dr = nbrs4[k][0], dc = nbrs4[k][1];
+	if (dc) {
+		int along = (ec - c)*dc;
+		if (er == r && along >= 1 && along <= reach) return grid_index(g, er, ec);
+	} else {
+		int along = (er - r)*dr;
+		if (along >= 1 && along <= reach) {
+			if (ec == c) return grid_index(g, er, ec);
+			/* the goal row: does a horizontal jump from (er,c) reach the goal? */
+			int hk = ec > c ? 3 : 2, hd = t->jd[(er*cols + c)*4 + hk];
+			if (abs(ec - c) <= (hd > 0 ? hd : -hd)) return grid_index(g, er, c);
+		}
+	}
+	return d > 0 ? grid_index(g, r + dr*d, c + dc*d) : -1;
+}
+
+THREAD_LOCAL JumpTable jps_cache;
+
+static ALWAYS_INLINE void jps_search(Grid *g, int sr, int sc, int er, int ec, int use_table, const MazeObserver *o) {
+	int rows = g->rows, cols = g->cols;
+	if (use_table && (jps_cache.version != g->version || jps_cache.rows != rows || jps_cache.cols != cols || !jps_cache.jd))
+		jps_table_build(&jps_cache, g);
+	int *parent = scratch_alloc(sizeof(int)*g->n);
+	int *dist = scratch_alloc(sizeof(int)*g->n);
+	for (int i=0; i<g->n; i++) {
+		parent[i] = -1;
+		dist[i] = INT_MAX;
+	}
+	solver_clear(g);
+
+	/* key: f in the high bits, h below it to prefer nodes nearer the goal */
+	Heap *h = heap_create(256);
+	int s = grid_index(g, sr, sc), goal = grid_index(g, er, ec);
+	dist[s] = 0;
+	parent[s] = -2;
+	heap_push(h, ((long long)(abs(er-sr) + abs(ec-sc)) << 32), s);
+	solver_mark(g, s, EV_FRONT, o);
+
+	while (!heap_empty(h)) {
+		long long key;
+		int cur = heap_pop(h, &key);
+		int r = grid_row(g, cur), c = grid_col(g, cur), hcur = abs(er-r) + abs(ec-c);
+		if ((key >> 32) != dist[cur] + hcur || (g->marks[cur] & M_VISIT)) continue;
+		solver_mark(g, cur, EV_VISIT, o);
+		if (cur == goal) break;
+
+		/* prune to the natural and forced directions of the arrival move */
+		int pd = -1;
+		if (parent[cur] >= 0) {
+			int pr = grid_row(g, parent[cur]), pc = grid_col(g, parent[cur]);
+			for (int k=0; k<4; k++)
+				if ((r-pr > 0) - (r-pr < 0) == nbrs4[k][0] && (c-pc > 0) - (c-pc < 0) == nbrs4[k][1]) pd = k;
+		}
+		for (int k=0; k<4; k++) {
+			if (pd >= 0 && k == (pd ^ 1)) continue; /* never straight back */
+			int nxt = use_table ? jps_jump_table(g, &jps_cache, r, c, k, er, ec)
+			          : jps_jump(g, r, c, nbrs4[k][0], nbrs4[k][1], er, ec);
+			if (nxt < 0) continue;
+			int nr = grid_row(g, nxt), nc = grid_col(g, nxt);
+			int nd = dist[cur] + abs(nr-r) + abs(nc-c);
+			if (nd < dist[nxt]) {
+				int hn = abs(er-nr) + abs(ec-nc);
+				dist[nxt] = nd;
+				parent[nxt] = cur;
+				heap_push(h, ((long long)(nd + hn) << 32) | hn, nxt);
+				solver_mark(g, nxt, EV_FRONT, o);
+			}
+		}
+	}
+
+	/* parents link jump points; fill in the straight runs between them */
+	if (parent[goal] != -1) {
+		for (int cur = goal; parent[cur] >= 0; ) {
+			int p = parent[cur], r = grid_row(g, cur), c = grid_col(g, cur);
+			int dr = (grid_row(g, p) > r) - (grid_row(g, p) < r), dc = (grid_col(g, p) > c) - (grid_col(g, p) < c);
+			for (int x = cur; x != p; x = parent[x]) {
+				r += dr;
+				c += dc;
+				parent[x] = grid_index(g, r, c);
+			}
+			cur = p;
+		}
+	}
+	reconstruct_and_mark(g, parent, er, ec, o);
+	heap_free(h);
+}
+
+static ALWAYS_INLINE void solve_jps(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	jps_search(g, sr, sc, er, ec, 0, o);
+}
+static ALWAYS_INLINE void solve_jps_plus(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	jps_search(g, sr, sc, er, ec, 1, o);
+}
+
+/* Lifelong Planning A* (Koenig & Likhachev): g/rhs values survive between
+   calls, so after a batch of wall toggles only cells whose shortest-path
+   cost actually changed are re-expanded. Moving into a cell costs its
+   cell_cost; the heap is lazy and skips entries whose key went stale. */
+
+static int lpa_h(const Lpa *l, int u) {
+	const Grid *g = l->g;
+	return abs(grid_row(g,u) - grid_row(g,l->t)) + abs(grid_col(g,u) - grid_col(g,l->t));
+}
+/* k1 = min(g, rhs) + h. Ties go to underconsistent cells (g < rhs) by
+   smaller k2 = min(g, rhs), as LPA* needs to stay correct, then to the
+   rest newest push first, as A*'s bucket queue pops them: otherwise a cold
+   solve floods plateaus of equal k1 instead of following one route. */
+static long long lpa_key(const Lpa *l, int u) {
+	int h = lpa_h(l,u);
+	if (l->gv[u] < l->rhs[u]) return ((long long)(l->gv[u] + h) << 32) | l->gv[u];
+	return ((long long)(l->rhs[u] + h) << 32) | LPA_INF | (LPA_INF - 1 - l->seq[u]);
+}
+
+static void lpa_update(Lpa *l, int u) {
+	Grid *g = l->g;
+	int r = grid_row(g, u), c = grid_col(g, u);
+	if (u != l->s) {
+		int best = LPA_INF;
+		if (!cell_is_wall(g->cells[u])) {
+			for (int k=0; k<4; k++) {
+				int nr = r + nbrs4[k][0], nc = c + nbrs4[k][1];
+				if (jps_open(g,nr,nc) && l->gv[grid_index(g, nr, nc)] < best) best = l->gv[grid_index(g, nr, nc)];
+			}
+			if (best < LPA_INF) best += cell_cost(g->cells[u]);
+		}
+		l->rhs[u] = best;
+	}
+	if (l->gv[u] != l->rhs[u]) {
+		l->seq[u] = l->pushes++ & (LPA_INF - 1);
+		heap_push(l->open, lpa_key(l,u), u);
+	}
+}
+
+Lpa *lpa_create(Grid *g, int sr, int sc, int er, int ec) {
+	int n = g->n;
+	Lpa *l = xmalloc(sizeof(Lpa));
+	l->g = g;
+	l->s = grid_index(g, sr, sc);
+	l->t = grid_index(g, er, ec);
+	l->gv = xmalloc(sizeof(int)*n);
+	l->rhs = xmalloc(sizeof(int)*n);
+	l->seq = xcalloc(n, sizeof(int));
+	l->pushes = 1;
+	for (int i=0; i<n; i++) l->gv[i] = l->rhs[i] = LPA_INF;
+	l->open = heap_create(256);
+	l->rhs[l->s] = 0;
+	heap_push(l->open, lpa_key(l, l->s), l->s);
+	l->expanded = 0;
+	return l;
+}
+void lpa_free(Lpa *l) {
+	heap_free(l->open);
+	free(l->gv);
+	free(l->rhs);
+	free(l->seq);
+	free(l);
+}
+
+/* drops stale heap entries; returns 0 when the queue is exhausted */
+static int lpa_peek(Lpa *l, long long *key) {
+	Heap *h = l->open;
+	while (!heap_empty(h)) {
+		int u = h->data[0].v;
+		if (l->gv[u] != l->rhs[u] && h->data[0].key == lpa_key(l,u)) {
+			*key = h->data[0].key;
+			return 1;
+		}
+		heap_pop(h, NULL);
+	}
+	return 0;
+}
+
+/* repairs the search; marks expanded cells M_VISIT and the path M_PATH
+   directly, so callers showing an overview must drop it afterwards */
+void lpa_compute(Lpa *l) {
+	Grid *g = l->g;
+	long long key;
+	memset(g->marks, M_NONE, g->n);
+	l->expanded = 0;
+	while (lpa_peek(l, &key) && (key < lpa_key(l, l->t) || l->rhs[l->t] != l->gv[l->t])) {
+		int u = heap_pop(l->open, NULL);
+		int r = grid_row(g, u), c = grid_col(g, u);
+		l->expanded++;
+		g->marks[u] |= M_VISIT;
+		if (l->gv[u] > l->rhs[u]) l->gv[u] = l->rhs[u];
+		else {
+			l->gv[u] = LPA_INF;
+			lpa_update(l, u);
+		}
+		for (int k=0; k<4; k++) {
+			int nr = r + nbrs4[k][0], nc = c + nbrs4[k][1];
+			if (is_inside(g,nr,nc)) lpa_update(l, grid_index(g, nr, nc));
+		}
+	}
+	if (l->gv[l->t] >= LPA_INF) return;
+	for (int u = l->t; ; ) {
+		g->marks[u] |= M_PATH;
+		if (u == l->s) break;
+		int r = grid_row(g, u), c = grid_col(g, u), best = -1;
+		for (int k=0; k<4; k++) {
+			int nr = r + nbrs4[k][0], nc = c + nbrs4[k][1];
+			if (jps_open(g,nr,nc) && (best < 0 || l->gv[grid_index(g, nr, nc)] < l->gv[best])) best = grid_index(g, nr, nc);
+		}
+		if (best < 0 || l->gv[best] >= l->gv[u]) break;
+		u = best;
+	}
+}
+
+/* flips the wall bit of each listed cell (the border, start and goal stay
+   fixed) and queues only the touched cells and their neighbours */
+void lpa_toggle(Lpa *l, const int *cells, int n) {
+	Grid *g = l->g;
+	int rows = g->rows, cols = g->cols;
+	for (int i=0; i<n; i++) {
+		int u = cells[i], r = grid_row(g, u), c = grid_col(g, u);
+		if (r <= 0 || c <= 0 || r >= rows-1 || c >= cols-1 || u == l->s || u == l->t) continue;
+		g->cells[u] ^= CELL_WALL;
+		grid_touch(g);
+		lpa_update(l, u);
+		for (int k=0; k<4; k++) lpa_update(l, grid_index(g, r + nbrs4[k][0], c + nbrs4[k][1]));
+	}
+}
+
+/* HPA* (Botea et al.): the grid is cut into HPA_K x HPA_K clusters, each
+   border gets entrance cells (one per open run, two for long runs), and the
+   cost between entrances of a cluster is precomputed. A query runs A* over
+   the entrances only and refines each abstract hop with a search confined
+   to one cluster. A wall edit rebuilds just its cluster and the neighbours.
+   Paths are near-optimal, never cheaper than Dijkstra's: on the generated
+   grids they cost at most 5/4 of the optimum plus 2*HPA_K (measured, not
+   guaranteed; tests/core_test.c keeps it that way). */
+#define HPA_K 16
+#define HPA_LONG_RUN 6 /* runs at least this long get an entrance at each end */
+
+typedef struct {
+	int n;
+	int *cells; /* entrance cells inside the cluster */
+	int *dist;  /* n*n costs between them, LPA_INF = not connected */
+} HpaCluster;
+
+struct Hpa {
+	Grid *g;
+	unsigned version;
+	int crows, ccols;
+	HpaCluster *cl;
+	int *node_of;      /* cell -> index in its cluster's list, -1 if not an entrance */
+	/* query state, valid where stamp == cur_stamp so nothing is cleared per query */
+	int *gv, *par;
+	unsigned *stamp, cur_stamp;
+	/* local search scratch, one cluster in size */
+	int *ldist, *lpar;
+	BucketQueue *bq;
+	long expanded;     /* abstract nodes expanded by the last query */
+};
+
+static int hpa_cluster_of(const Hpa *h, int u) {
+	return grid_row(h->g, u) / HPA_K * h->ccols + grid_col(h->g, u) / HPA_K;
+}
+
+/* Dijkstra from src confined to cluster ci; stops early once dst (if >= 0)
+   is settled. Results land in ldist/lpar by local index. */
+static void hpa_local(Hpa *h, int ci, int src, int dst) {
+	Grid *g = h->g;
+	int cols = g->cols;
+	int r0 = ci / h->ccols * HPA_K, c0 = ci % h->ccols * HPA_K;
+	int r1 = r0 + HPA_K < g->rows ? r0 + HPA_K : g->rows;
+	int c1 = c0 + HPA_K < cols ? c0 + HPA_K : cols;
+	for (int i=0; i<HPA_K*HPA_K; i++) h->ldist[i] = LPA_INF;
+	BucketQueue *q = h->bq;
+	for (int i=0; i<BQ_SPAN; i++) q->b[i].len = 0;
+	q->count = q->cur = 0;
+	int ls = (grid_row(g, src) - r0)*HPA_K + grid_col(g, src) - c0;
+	h->ldist[ls] = 0;
+	h->lpar[ls] = -1;
+	bq_push(q, 0, ls);
+	while (!bq_empty(q)) {
+		int d, lu = bq_pop(q, &d);
+		if (d != h->ldist[lu]) continue;
+		int r = r0 + lu / HPA_K, c = c0 + lu % HPA_K;
+		if (grid_index(g, r, c) == dst) break;
+		STAT_ADD(neighbours, 4);
+		for (int k=0; k<4; k++) {
+			int nr = r + nbrs4[k][0], nc = c + nbrs4[k][1];
+			if (nr < r0 || nr >= r1 || nc < c0 || nc >= c1) continue;
+			cell_t cell = grid_get(g,nr,nc);
+			int ln = (nr - r0)*HPA_K + nc - c0, nd = d + cell_cost(cell);
+			if (!cell_is_wall(cell) && nd < h->ldist[ln]) {
+				h->ldist[ln] = nd;
+				h->lpar[ln] = lu;
+				bq_push(q, nd, ln);
+			}
+		}
+	}
+}
+static int hpa_ldist(const Hpa *h, int ci, int u) {
+	int r0 = ci / h->ccols * HPA_K, c0 = ci % h->ccols * HPA_K;
+	return h->ldist[(grid_row(h->g, u) - r0)*HPA_K + grid_col(h->g, u) - c0];
+}
+
+static void hpa_add_node(Hpa *h, HpaCluster *cl, int u) {
+	if (h->node_of[u] >= 0) return; /* corner cell shared by two borders */
+	h->node_of[u] = cl->n;
+	cl->cells[cl->n++] = u;
+}
+
+/* entrances along one border: side is 0..3 in nbrs4 order, the cells on
+   both sides of the border must be open; placement only depends on the
+   border itself, so both clusters agree on it */
+static void hpa_border(Hpa *h, HpaCluster *cl, int ci, int side) {
+	Grid *g = h->g;
+	int cols = g->cols;
+	int r0 = ci / h->ccols * HPA_K, c0 = ci % h->ccols * HPA_K;
+	int r1 = r0 + HPA_K < g->rows ? r0 + HPA_K : g->rows;
+	int c1 = c0 + HPA_K < cols ? c0 + HPA_K : cols;
+	int dr = nbrs4[side][0], dc = nbrs4[side][1];
+	/* walk along the border: fixed row for up/down, fixed column for left/right */
+	int len = dr ? c1 - c0 : r1 - r0;
+	int fr = dr < 0 ? r0 : r1 - 1, fc = dc < 0 ? c0 : c1 - 1;
+	int run = 0;
+	for (int i=0; i<=len; i++) {
+		int r = dr ? fr : r0 + i, c = dr ? c0 + i : fc;
+		int open = i < len && jps_open(g,r,c) && jps_open(g,r+dr,c+dc);
+		if (open) {
+			run++;
+			continue;
+		}
+		if (run) {
+			int a = i - run, b = i - 1;
+			int picks[2] = { run >= HPA_LONG_RUN ? a : (a+b)/2, b };
+			for (int p=0; p < (run >= HPA_LONG_RUN ? 2 : 1); p++)
+				hpa_add_node(h, cl, dr ? grid_index(g, fr, c0 + picks[p]) : grid_index(g, r0 + picks[p], fc));
+		}
+		run = 0;
+	}
+}
+
+static void hpa_build_cluster(Hpa *h, int ci) {
+	HpaCluster *cl = &h->cl[ci];
+	for (int i=0; i<cl->n; i++) h->node_of[cl->cells[i]] = -1;
+	cl->n = 0;
+	for (int side=0; side<4; side++) hpa_border(h, cl, ci, side);
+	for (int i=0; i<cl->n; i++) {
+		hpa_local(h, ci, cl->cells[i], -1);
+		for (int j=0; j<cl->n; j++) cl->dist[i*cl->n + j] = hpa_ldist(h, ci, cl->cells[j]);
+	}
+}
+
+Hpa *hpa_create(Grid *g) {
+	int n = g->n;
+	Hpa *h = xcalloc(1, sizeof(Hpa));
+	h->g = g;
+	h->version = g->version;
+	h->crows = (g->rows + HPA_K-1) / HPA_K;
+	h->ccols = (g->cols + HPA_K-1) / HPA_K;
+	h->cl = xcalloc(h->crows * h->ccols, sizeof(HpaCluster));
+	h->node_of = xmalloc(sizeof(int)*n);
+	h->gv = xmalloc(sizeof(int)*n);
+	h->par = xmalloc(sizeof(int)*n);
+	h->stamp = xcalloc(n, sizeof(unsigned));
+	h->ldist = xmalloc(sizeof(int)*HPA_K*HPA_K);
+	h->lpar = xmalloc(sizeof(int)*HPA_K*HPA_K);
+	h->bq = bq_create();
+	for (int i=0; i<n; i++) h->node_of[i] = -1;
+	/* at most 2 entrances per run and a run per two border cells */
+	int maxn = 4 * (HPA_K + 1);
+	for (int ci=0; ci<h->crows*h->ccols; ci++) {
+		h->cl[ci].cells = xmalloc(sizeof(int)*maxn);
+		h->cl[ci].dist = xmalloc(sizeof(int)*maxn*maxn);
+		hpa_build_cluster(h, ci);
+	}
+	return h;
+}
+void hpa_free(Hpa *h) {
+	for (int ci=0; ci<h->crows*h->ccols; ci++) {
+		free(h->cl[ci].cells);
+		free(h->cl[ci].dist);
+	}
+	free(h->cl);
+	free(h->node_of);
+	free(h->gv);
+	free(h->par);
+	free(h->stamp);
+	free(h->ldist);
+	free(h->lpar);
+	bq_free(h->bq);
+	free(h);
+}
+
+/* cluster-local update after cell u changed */
+void hpa_update(Hpa *h, int u) {
+	int ci = hpa_cluster_of(h, u), cr = ci / h->ccols, cc = ci % h->ccols;
+	hpa_build_cluster(h, ci);
+	for (int k=0; k<4; k++) {
+		int nr = cr + nbrs4[k][0], nc = cc + nbrs4[k][1];
+		if (nr >= 0 && nr < h->crows && nc >= 0 && nc < h->ccols) hpa_build_cluster(h, nr*h->ccols + nc);
+	}
+	h->version = h->g->version;
+}
+
+static void hpa_relax(Hpa *h, Heap *open, int u, int d, int from, int t) {
+	const Grid *g = h->g;
+	if (h->stamp[u] == h->cur_stamp && h->gv[u] <= d) return;
+	h->stamp[u] = h->cur_stamp;
+	h->gv[u] = d;
+	h->par[u] = from;
+	heap_push(open, d + abs(grid_row(g,u) - grid_row(g,t)) + abs(grid_col(g,u) - grid_col(g,t)), u);
+}
+
+/* marks the local path from a to b (same cluster) with M_PATH */
+static void hpa_refine(Hpa *h, int a, int b, const MazeObserver *o) {
+	Grid *g = h->g;
+	int ci = hpa_cluster_of(h, a);
+	int r0 = ci / h->ccols * HPA_K, c0 = ci % h->ccols * HPA_K;
+	hpa_local(h, ci, a, b);
+	for (int lu = (grid_row(g, b) - r0)*HPA_K + grid_col(g, b) - c0; lu >= 0; lu = h->lpar[lu])
+		solver_mark(g, grid_index(g, r0 + lu/HPA_K, c0 + lu%HPA_K), EV_PATH, o);
+}
+
+/* answers s -> t over the abstraction, reporting marks to o (NULL for
+   none); returns the path cost or LPA_INF */
+int hpa_query(Hpa *h, int s, int t, const MazeObserver *o) {
+	Grid *g = h->g;
+	int cs = hpa_cluster_of(h, s), ct = hpa_cluster_of(h, t);
+	int tr = grid_row(g, t), tc = grid_col(g, t);
+	HpaCluster *clt = &h->cl[ct];
+	if (++h->cur_stamp == 0) {
+		memset(h->stamp, 0, sizeof(unsigned) * g->n);
+		h->cur_stamp = 1;
+	}
+	h->expanded = 0;
+	Heap *open = heap_create(256);
+
+	/* s joins the entrances of its cluster, and t those of its own:
+	   cost(x -> t) = cost(t -> x) - cost(x) + cost(t) */
+	int *to_t = scratch_alloc(sizeof(int) * (clt->n + 1));
+	hpa_local(h, ct, t, -1);
+	for (int j=0; j<clt->n; j++) {
+		int d = hpa_ldist(h, ct, clt->cells[j]);
+		to_t[j] = d >= LPA_INF ? LPA_INF : d - cell_cost(g->cells[clt->cells[j]]) + cell_cost(g->cells[t]);
+	}
+	hpa_local(h, cs, s, -1);
+	hpa_relax(h, open, s, 0, -1, t);
+	if (cs == ct && hpa_ldist(h, cs, t) < LPA_INF) hpa_relax(h, open, t, hpa_ldist(h, cs, t), s, t);
+	for (int j=0; j<h->cl[cs].n; j++) {
+		int x = h->cl[cs].cells[j], d = hpa_ldist(h, cs, x);
+		if (d < LPA_INF && x != s) hpa_relax(h, open, x, d, s, t);
+	}
+
+	while (!heap_empty(open)) {
+		long long key;
+		int u = heap_pop(open, &key);
+		int r = grid_row(g, u), c = grid_col(g, u);
+		if (key != h->gv[u] + abs(r - tr) + abs(c - tc)) continue;
+		h->expanded++;
+		solver_mark(g, u, EV_VISIT, o);
+		if (u == t) break;
+		int ci = hpa_cluster_of(h, u), i = h->node_of[u];
+		if (i < 0) continue; /* s when it is not an entrance itself */
+		HpaCluster *cl = &h->cl[ci];
+		for (int j=0; j<cl->n; j++)
+			if (j != i && cl->dist[i*cl->n + j] < LPA_INF)
+				hpa_relax(h, open, cl->cells[j], h->gv[u] + cl->dist[i*cl->n + j], u, t);
+		if (ci == ct && to_t[i] < LPA_INF) hpa_relax(h, open, t, h->gv[u] + to_t[i], u, t);
+		STAT_ADD(neighbours, 4);
+		for (int k=0; k<4; k++) {
+			int nr = r + nbrs4[k][0], nc = c + nbrs4[k][1];
+			if (!jps_open(g,nr,nc)) continue;
+			int v = grid_index(g, nr, nc);
+			if (h->node_of[v] < 0 || hpa_cluster_of(h, v) == ci) continue;
+			hpa_relax(h, open, v, h->gv[u] + cell_cost(g->cells[v]), u, t);
+		}
+	}
+	heap_free(open);
+	if (h->stamp[t] != h->cur_stamp) return LPA_INF;
+
+	/* refine: hops across a border are single steps, the rest stay in one cluster */
+	for (int u = t; u != s; u = h->par[u]) {
+		int p = h->par[u];
+		if (hpa_cluster_of(h, p) != hpa_cluster_of(h, u)) solver_mark(g, u, EV_PATH, o);
+		else hpa_refine(h, p, u, o);
+	}
+	solver_mark(g, s, EV_PATH, o);
+	return h->gv[t];
+}
+
+THREAD_LOCAL Hpa *hpa_cache;
+
+/* the thread's abstraction, rebuilt unless it was built for g as it is now */
+Hpa *hpa_cached(Grid *g) {
+	if (!hpa_cache || hpa_cache->g != g || hpa_cache->version != g->version ||
+	    hpa_cache->crows != (g->rows + HPA_K-1) / HPA_K || hpa_cache->ccols != (g->cols + HPA_K-1) / HPA_K) {
+		if (hpa_cache) hpa_free(hpa_cache);
+		hpa_cache = hpa_create(g);
+	}
+	return hpa_cache;
+}
+
+static ALWAYS_INLINE void solve_hpa(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	Hpa *h = hpa_cached(g);
+	solver_clear(g);
+	hpa_query(h, grid_index(g, sr, sc), grid_index(g, er, ec), o);
+}
+
+/* the watched and headless copy of each solver */
+#define SOLVER(name) \
+	static void name##_watched(Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) { name(g, sr, sc, er, ec, o); } \
+	static void name##_headless(Grid *g, int sr, int sc, int er, int ec) { name(g, sr, sc, er, ec, NULL); }
+SOLVER(solve_dfs)
+SOLVER(solve_bfs)
+SOLVER(solve_dijkstra)
+SOLVER(solve_astar_with)
+SOLVER(solve_jps)
+SOLVER(solve_jps_plus)
+SOLVER(solve_hpa)
+SOLVER(solve_alt)
+
+typedef void (*WatchedFn)(Grid*, int, int, int, int, const MazeObserver*);
+typedef void (*HeadlessFn)(Grid*, int, int, int, int);
+static const WatchedFn watched_solvers[] = { NULL, solve_dfs_watched, solve_bfs_watched, solve_dijkstra_watched, solve_astar_with_watched,
+	solve_jps_watched, solve_jps_plus_watched, solve_hpa_watched, solve_alt_watched };
+static const HeadlessFn headless_solvers[] = { NULL, solve_dfs_headless, solve_bfs_headless, solve_dijkstra_headless, solve_astar_with_headless,
+	solve_jps_headless, solve_jps_plus_headless, solve_hpa_headless, solve_alt_headless };
+const char *algo_names[ALGO_COUNT+1] = { "", "DFS", "BFS", "Dijkstra", "A*", "JPS", "JPS+", "HPA*", "ALT A*" };
+
+static void solve_any(int algo, Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	if (o) watched_solvers[algo](g, sr, sc, er, ec, o);
+	else headless_solvers[algo](g, sr, sc, er, ec);
+}
+
+/* solver entry point, timed for the stats phases (search time excludes the
+   rendering and sleeping done by observers); releases its scratch when done
+   and returns the path cells marked */
+long run_solver(int algo, Grid *g, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	path_cells = 0;
+#ifndef MAZE_NO_STATS
+	double t0 = now_ms(), inner = stats.phase_ms[PH_RENDER] + stats.phase_ms[PH_SLEEP];
+	solve_any(algo, g, sr, sc, er, ec, o);
+	inner = stats.phase_ms[PH_RENDER] + stats.phase_ms[PH_SLEEP] - inner;
+	stats.phase_ms[PH_SEARCH] += now_ms() - t0 - inner;
+	stats.solves++;
+#else
+	solve_any(algo, g, sr, sc, er, ec, o);
+#endif
+	scratch_reset();
+	if (o && o->on_done) o->on_done(o->ctx, g, path_cells);
+	return path_cells;
+}
+
+long maze_solve(MazeGrid *g, int algo, int sr, int sc, int er, int ec, const MazeObserver *o) {
+	if (algo < 1 || algo > ALGO_COUNT || !is_inside(g, sr, sc) || !is_inside(g, er, ec)) return 0;
+	return run_solver(algo, g, sr, sc, er, ec, o);
+}
+const char *maze_algo_name(int algo) {
+	return algo >= 1 && algo <= ALGO_COUNT ? algo_names[algo] : NULL;
+}
+int maze_algo_find(const char *name) {
+	for (int i=1; i<=ALGO_COUNT; i++)
+		if (!strcmp(algo_names[i], name)) return i;
+	return -1;
+}
+
+/* releases this thread's JPS+, HPA* and ALT tables, spare chunks and scratch */
+void solver_caches_free(void) {
+	chunk_pool_free();
+	scratch_free();
+	free(jps_cache.jd);
+	memset(&jps_cache, 0, sizeof jps_cache);
+	if (hpa_cache) hpa_free(hpa_cache);
+	hpa_cache = NULL;
+	if (alt_cache) landmarks_free(alt_cache);
+	alt_cache = NULL;
+}
+void maze_thread_release(void) {
+	solver_caches_free();
+	render_release();
+}
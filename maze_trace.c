@@ -0,0 +1,119 @@
+/* maze_trace.c - solver event trace writer */
+
+#include "maze_internal.h"
+
+
+
+static void trace_bytes(Trace *t, const void *p, size_t n) {
+	if (t->len + n > t->cap) {
+		while (t->len + n > t->cap) t->cap = t->cap ? t->cap*2 : TRACE_FLUSH*2;
+		t->buf = xrealloc(t->buf, t->cap);
+	}
+	memcpy(t->buf + t->len, p, n);
+	t->len += n;
+}
+static void trace_varint(Trace *t, unsigned long long v) {
+	unsigned char b[10];
+	int n = 0;
+	while (v >= 0x80) {
+		b[n++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	b[n++] = (unsigned char)v;
+	trace_bytes(t, b, n);
+}
+static void trace_flush(Trace *t) {
+	if (!t->f || t->len < TRACE_FLUSH) return;
+	if (fwrite(t->buf, 1, t->len, t->f) != t->len) t->failed = 1;
+	t->flushed += t->len;
+	t->len = 0;
+}
+
+static void trace_key(Trace *t, const Grid *g) {
+	if (t->nkeys == t->keycap) {
+		t->keycap = t->keycap ? t->keycap*2 : 64;
+		t->keys = xrealloc(t->keys, sizeof(long long) * 2 * t->keycap);
+	}
+	t->keys[2*t->nkeys] = t->events;
+	t->keys[2*t->nkeys + 1] = (long long)(t->flushed + t->len);
+	t->nkeys++;
+	trace_varint(t, EV_KEY);
+	trace_varint(t, (unsigned long long)t->events);
+	trace_varint(t, (unsigned long long)t->last);
+	size_t n = (size_t)g->rows * g->cols;
+	for (size_t i=0; i<n; ) { /* row-major runs, whatever the layout */
+		mark_t m = g->marks[grid_at(g, (int)i)];
+		size_t j = i + 1;
+		while (j < n && g->marks[grid_at(g, (int)j)] == m) j++;
+		trace_varint(t, j - i);
+		trace_bytes(t, &m, 1);
+		i = j;
+	}
+	trace_flush(t);
+}
+
+/* call right before a solve: marks are cleared as every solver does first.
+   path NULL keeps the trace in memory; returns NULL if the file can't be created */
+Trace *trace_open(const char *path, Grid *g, int sr, int sc, int er, int ec) {
+	Trace *t = xcalloc(1, sizeof(Trace));
+	if (path && !(t->f = fopen(path, "wb"))) {
+		free(t);
+		return NULL;
+	}
+	size_t n = (size_t)g->rows * g->cols;
+	t->key_every = n > TRACE_KEY_MIN ? (int)n : TRACE_KEY_MIN;
+	cell_t *cells = cells_rows(g);
+	int costs = cells_have_costs(cells, n);
+	unsigned char h[TRACE_HEADER] = { 'M','T','R','C' };
+	put_le(h+4, TRACE_VERSION, 2);
+	int fields[8] = { g->rows, g->cols, sr, sc, er, ec, t->key_every, costs ? MF_COSTS : 0 };
+	for (int i=0; i<8; i++) put_le(h + 8 + 4*i, (unsigned)fields[i], 4);
+	trace_bytes(t, h, TRACE_HEADER);
+	size_t body = cells_packed_size(n, costs);
+	unsigned char *packed = xmalloc(body);
+	cells_pack(cells, n, costs, packed);
+	cells_rows_done(g, cells);
+	trace_bytes(t, packed, body);
+	free(packed);
+	solver_clear(g);
+	trace_key(t, g);
+	return t;
+}
+
+void trace_event(Trace *t, const Grid *g, int u, int ev) {
+	u = grid_rm(g, u);
+	long long d = (long long)u - t->last;
+	unsigned long long zz = d < 0 ? ((unsigned long long)(-d) << 1) - 1 : (unsigned long long)d << 1;
+	trace_varint(t, zz << 2 | (unsigned)ev);
+	t->last = u;
+	if (++t->events % t->key_every == 0) trace_key(t, g);
+	else trace_flush(t);
+}
+
+/* writes the key index and closes the file, storing the trace size;
+   returns nonzero if any write to the file failed */
+int trace_close(Trace *t, size_t *size) {
+	size_t index_at = t->flushed + t->len;
+	unsigned char b[16];
+	put_le(b, (unsigned)t->nkeys, 4);
+	trace_bytes(t, b, 4);
+	for (int i=0; i<t->nkeys; i++) {
+		put_le(b, (unsigned long long)t->keys[2*i], 8);
+		put_le(b+8, (unsigned long long)t->keys[2*i+1], 8);
+		trace_bytes(t, b, 16);
+	}
+	put_le(b, index_at, 8);
+	memcpy(b+8, "MTRE", 4);
+	trace_bytes(t, b, 12);
+	*size = t->flushed + t->len;
+	if (t->f) {
+		if (fwrite(t->buf, 1, t->len, t->f) != t->len) t->failed = 1;
+		if (fclose(t->f)) t->failed = 1;
+	}
+	int failed = t->failed;
+	free(t->buf);
+	free(t->keys);
+	free(t);
+	return failed;
+}
+
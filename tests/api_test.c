@@ -0,0 +1,88 @@
+/* api_test.c - exercises libmaze through maze.h alone, linked against the
+   shared library: generate, save, load, regenerate the loaded grid and
+   solve it. Exits non-zero if any check fails. */
+#include <stdio.h>
+#include <string.h>
+#include "maze.h"
+
+#define ROWS 41
+#define COLS 61
+
+static int checks, failed;
+
+static void check(int ok, const char *what) {
+	checks++;
+	if (ok) return;
+	failed++;
+	fprintf(stderr, "api_test: FAILED: %s\n", what);
+}
+
+static int same_cells(const MazeGrid *a, const MazeGrid *b) {
+	for (int r=0; r<ROWS; r++)
+		for (int c=0; c<COLS; c++)
+			if (maze_cell(a, r, c) != maze_cell(b, r, c)) return 0;
+	return 1;
+}
+
+static long solve_corners(MazeGrid *g, int algo) {
+	return maze_solve(g, algo, 1, 1, ROWS-2, COLS-2, NULL);
+}
+
+int main(int argc, char **argv) {
+	const char *path = argc > 1 ? argv[1] : "api_test.maze";
+
+	MazeGrid *a = maze_grid_new(ROWS, COLS), *b = maze_grid_new(ROWS, COLS);
+	check(a && b, "maze_grid_new");
+	if (!a || !b) return 1;
+	check(maze_grid_new(2, 2) == NULL, "maze_grid_new rejects tiny grids");
+	maze_generate(a, MAZE_GEN_MAZE, 3);
+	maze_generate(b, MAZE_GEN_ROOMS, 9);
+	long pa = solve_corners(a, MAZE_BFS), pb = solve_corners(b, MAZE_BFS);
+	check(pa > 0 && pb > 0, "generated mazes are solvable");
+	/* a perfect maze has one path, so every solver must find it */
+	for (int algo=MAZE_DFS; algo<=MAZE_ALGO_LAST; algo++)
+		check(solve_corners(a, algo) == pa, maze_algo_name(algo));
+
+	/* raw bodies load as a read-only mapping; generating over one must
+	   copy it first, and must leave the file alone */
+	check(maze_grid_save(a, path, 3, MAZE_GEN_MAZE, 0) == 0, "maze_grid_save");
+	unsigned long long seed = 0;
+	int gen = -1;
+	const char *err = NULL;
+	MazeGrid *l = maze_grid_load(path, 1, &seed, &gen, &err);
+	check(l != NULL, err ? err : "maze_grid_load");
+	if (l) {
+		check(seed == 3 && gen == MAZE_GEN_MAZE, "loaded seed and generator");
+		check(same_cells(l, a), "loaded cells");
+		check(solve_corners(l, MAZE_ASTAR) == pa, "solve loaded grid");
+		maze_generate(l, MAZE_GEN_ROOMS, 9);
+		check(same_cells(l, b), "generate over loaded grid");
+		check(solve_corners(l, MAZE_BFS) == pb, "solve regenerated grid");
+		maze_grid_free(l);
+	}
+	l = maze_grid_load(path, 1, &seed, &gen, &err);
+	check(l && same_cells(l, a), "file unchanged by generate");
+	if (l) {
+		maze_set_cell(l, 1, 2, MAZE_WALL);
+		check(maze_cell(l, 1, 2) == MAZE_WALL, "maze_set_cell on loaded grid");
+		maze_grid_free(l);
+	}
+	remove(path);
+
+	/* one sweep agrees with the single-target solve */
+	int src = 1*COLS + 1, tgt = (ROWS-2)*COLS + COLS-2;
+	MazeMulti *m = maze_search_multi(a, &src, 1, &tgt, 1, MAZE_STOP_ALL, NULL);
+	check(m && maze_multi_reached(m) == 1, "maze_search_multi");
+	if (m) {
+		int cells[ROWS*COLS];
+		check(maze_multi_path(m, tgt, cells, ROWS*COLS) == pa - 1, "maze_multi_path steps");
+		check(cells[0] == src, "maze_multi_path starts at the source");
+		maze_multi_free(m);
+	}
+
+	maze_grid_free(a);
+	maze_grid_free(b);
+	maze_thread_release();
+	printf("api_test: %d checks, %d failed\n", checks, failed);
+	return failed != 0;
+}
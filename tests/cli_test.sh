@@ -0,0 +1,83 @@
+#!/bin/sh
+# cli_test.sh - checks of the maze program itself: trace round trips,
+# damaged traces, frame patterns and option names. Usage: cli_test.sh MAZE DIR, with
+# scratch files in DIR. Exits non-zero if any check fails.
+maze=${1:-./maze}
+dir=${2:-.}
+checks=0
+failed=0
+
+check() {
+	checks=$((checks + 1))
+	if [ "$1" != 0 ]; then
+		failed=$((failed + 1))
+		echo "cli_test: FAILED: $2" >&2
+	fi
+}
+# expect STATUS WHAT COMMAND...: the command exits with STATUS
+expect() {
+	want=$1 what=$2
+	shift 2
+	"$@" > "$dir/cli_test.out" 2>&1 < /dev/null
+	got=$?
+	[ "$got" = "$want" ]
+	check $? "$what (exit $got, expected $want)"
+}
+
+# a trace replays to the events it recorded, from the start and after a seek
+trace=$dir/cli_test.mtr
+expect 0 "--trace" "$maze" --trace "$trace" --rows 101 --cols 101 --gen rooms --algo 'A*' --seed 3
+events=$(sed -n 's/.*: \([0-9]*\) events.*/\1/p' "$dir/cli_test.out")
+expect 0 "--replay" "$maze" --replay "$trace" --summary
+grep -q " $events events " "$dir/cli_test.out"
+check $? "replay counts $events events"
+expect 0 "--replay --seek" "$maze" --replay "$trace" --summary --seek $((events / 2))
+grep -q " $events events " "$dir/cli_test.out"
+check $? "replay after a seek counts $events events"
+
+# damaged traces are refused, never replayed
+size=$(wc -c < "$trace")
+for cut in 1 40 $((size / 2)) $((size - 1)); do
+	head -c $cut "$trace" > "$dir/cli_test_bad.mtr"
+	expect 1 "trace truncated to $cut bytes" "$maze" --replay "$dir/cli_test_bad.mtr" --summary
+	{ head -c $cut "$trace"; tail -c 12 "$trace"; } > "$dir/cli_test_bad.mtr"
+	expect 1 "trace cut at $cut bytes with its trailer" "$maze" --replay "$dir/cli_test_bad.mtr" --summary
+done
+for field in 8 12 16 36; do
+	{ head -c $field "$trace"; printf '\377\377\377\177'; tail -c +$((field + 5)) "$trace"; } > "$dir/cli_test_bad.mtr"
+	expect 1 "trace with header field at $field out of range" "$maze" --replay "$dir/cli_test_bad.mtr" --summary
+done
+{ head -c $((size - 12)) "$trace"; printf '\377\377\377\377\0\0\0\0MTRE'; } > "$dir/cli_test_bad.mtr"
+expect 1 "trace with its index past the end" "$maze" --replay "$dir/cli_test_bad.mtr" --summary
+grep -q "corrupt trace" "$dir/cli_test.out"
+check $? "damaged trace reported as corrupt"
+
+# frame patterns go to snprintf: exactly one int conversion, %% allowed
+for pattern in 'f_%s.ppm' 'f.ppm' 'f_%n%d.ppm' 'f_%d_%d.ppm' 'f_%ld.ppm' 'f_%'; do
+	expect 1 "--record $pattern refused" "$maze" --record "$dir/$pattern" --rows 21 --cols 21 --every 50
+done
+expect 0 "--record with a frame pattern" "$maze" --record "$dir/cli_test_%%_%03d.ppm" --rows 21 --cols 21 --every 50
+[ -f "$dir/cli_test_%_000.ppm" ] && [ -f "$dir/cli_test_%_001.ppm" ]
+check $? "numbered frames written"
+rm -f "$dir"/cli_test_%_*.ppm
+
+# names must match: no silent fallback to the first algorithm, generator
+# or render mode
+expect 1 "--algo jsp refused" "$maze" --export "$dir/cli_test.ppm" --rows 21 --cols 21 --algo jsp
+expect 1 "--gen mazes refused" "$maze" --export "$dir/cli_test.ppm" --rows 21 --cols 21 --gen mazes
+grep -q "unknown generator 'mazes'" "$dir/cli_test.out"
+check $? "unknown name reported"
+expect 0 "--algo JPS --gen rooms" "$maze" --export "$dir/cli_test.ppm" --rows 21 --cols 21 --algo JPS --gen rooms
+grep -q "^JPS solve" "$dir/cli_test.out"
+check $? "--algo by name"
+expect 0 "--algo by number" "$maze" --export "$dir/cli_test.ppm" --rows 21 --cols 21 --algo 4
+grep -q "^A\* solve" "$dir/cli_test.out"
+check $? "--algo by number"
+rm -f "$dir/cli_test.ppm"
+expect 1 "--render blocks refused" "$maze" --render blocks --rows 21 --cols 21
+grep -q "unknown render mode 'blocks'" "$dir/cli_test.out"
+check $? "unknown render mode reported"
+
+rm -f "$trace" "$dir/cli_test_bad.mtr" "$dir/cli_test.out"
+echo "cli_test: $checks checks, $failed failed"
+[ "$failed" = 0 ]
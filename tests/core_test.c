@@ -0,0 +1,521 @@
+/* core_test.c - checks libmaze internals that the public API doesn't
+   reach, linked against the static library. Scratch files go to the
+   directory given as the first argument. Exits non-zero if any check
+   fails. */
+#include "maze_internal.h"
+
+static int checks, failed;
+static const char *dir = ".";
+
+static void check(int ok, const char *what) {
+	checks++;
+	if (ok) return;
+	failed++;
+	fprintf(stderr, "core_test: FAILED: %s\n", what);
+}
+
+static const char *scratch(const char *name) {
+	static char path[1024];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	return path;
+}
+
+static unsigned char *read_file(const char *path, size_t *len) {
+	FILE *f = fopen(path, "rb");
+	if (!f) return NULL;
+	size_t cap = 1 << 16;
+	unsigned char *d = xmalloc(cap);
+	*len = 0;
+	for (size_t k; (k = fread(d + *len, 1, cap - *len, f)) > 0; )
+		if ((*len += k) == cap) d = xrealloc(d, cap *= 2);
+	fclose(f);
+	return d;
+}
+
+static unsigned get_be32(const unsigned char *p) {
+	return (unsigned)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static int random_open(const Grid *g) {
+	int u;
+	do u = rng_int() % g->n; while (cell_is_wall(g->cells[u]));
+	return u;
+}
+/* cost of the path the last solve marked, LPA_INF when it found none */
+static int marked_cost(const Grid *g, int s, long path) {
+	if (!path) return LPA_INF;
+	int cost = 0;
+	for (int u=0; u<g->n; u++)
+		if ((g->marks[u] & M_PATH) && u != s) cost += cell_cost(g->cells[u]);
+	return cost;
+}
+static int dijkstra_cost(Grid *g, int s, int t) {
+	long path = run_solver(MAZE_DIJKSTRA, g, grid_row(g,s), grid_col(g,s), grid_row(g,t), grid_col(g,t), NULL);
+	scratch_reset();
+	return marked_cost(g, s, path);
+}
+/* flips the wall bit of a random inner cell, returns it */
+static int toggle_random(Grid *g) {
+	int u = grid_index(g, 1 + rng_int() % (g->rows-2), 1 + rng_int() % (g->cols-2));
+	g->cells[u] ^= CELL_WALL;
+	grid_touch(g);
+	return u;
+}
+
+
+/* HPA*: never cheaper than optimal, and on the generated mazes at most
+   5/4 of it plus two cluster widths (2 * HPA_K); the same holds after
+   cluster-local updates */
+static void test_hpa(void) {
+	for (int gen=0; gen<GEN_COUNT; gen++) {
+		Grid g;
+		grid_init(&g, 161, 201);
+		rng_seed(gen + 5);
+		run_generator(gen, &g);
+		Hpa *h = hpa_create(&g);
+		int bad = 0;
+		for (int i=0; i<200; i++) {
+			if (i >= 100) hpa_update(h, toggle_random(&g));
+			int s = random_open(&g), t = random_open(&g);
+			int d = dijkstra_cost(&g, s, t), c = hpa_query(h, s, t, NULL);
+			scratch_reset();
+			if (d >= LPA_INF ? c < LPA_INF : c < d || c > d + d/4 + 32) bad++;
+		}
+		char what[64];
+		snprintf(what, sizeof(what), "HPA* within bound on %s", gen_names[gen]);
+		check(!bad, what);
+		hpa_free(h);
+		grid_free(&g);
+	}
+}
+
+/* JPS and JPS+ ignore terrain costs: their paths have BFS's step count,
+   also after edits that the JPS+ table must notice */
+static void test_jps(void) {
+	for (int gen=0; gen<GEN_COUNT; gen++) {
+		Grid g;
+		grid_init(&g, 121, 141);
+		rng_seed(gen + 7);
+		run_generator(gen, &g);
+		int bad = 0;
+		for (int i=0; i<150; i++) {
+			if (i >= 75) toggle_random(&g);
+			int s = random_open(&g), t = random_open(&g);
+			int sr = grid_row(&g,s), sc = grid_col(&g,s), tr = grid_row(&g,t), tc = grid_col(&g,t);
+			long bfs = run_solver(MAZE_BFS, &g, sr, sc, tr, tc, NULL);
+			long jps = run_solver(MAZE_JPS, &g, sr, sc, tr, tc, NULL);
+			long plus = run_solver(MAZE_JPS_PLUS, &g, sr, sc, tr, tc, NULL);
+			scratch_reset();
+			bad += jps != bfs || plus != bfs;
+		}
+		char what[64];
+		snprintf(what, sizeof(what), "JPS and JPS+ match BFS on %s", gen_names[gen]);
+		check(!bad, what);
+		grid_free(&g);
+	}
+}
+
+/* LPA*: after every batch of toggles the repaired goal cost is Dijkstra's */
+static void test_lpa(void) {
+	for (int gen=0; gen<GEN_COUNT; gen++) {
+		for (int seed=1; seed<=2; seed++) {
+			Grid g;
+			grid_init(&g, 81, 101);
+			rng_seed(seed);
+			run_generator(gen, &g);
+			int s = grid_index(&g, 1, 1), t = grid_index(&g, g.rows-2, g.cols-2);
+			Lpa *l = lpa_create(&g, 1, 1, g.rows-2, g.cols-2);
+			lpa_compute(l);
+			int bad = l->gv[t] != dijkstra_cost(&g, s, t);
+			for (int i=0; i<150; i++) {
+				int cells[3], k = 1 + rng_int() % 3;
+				for (int j=0; j<k; j++)
+					cells[j] = grid_index(&g, 1 + rng_int() % (g.rows-2), 1 + rng_int() % (g.cols-2));
+				lpa_toggle(l, cells, k);
+				lpa_compute(l);
+				int c = l->gv[t] < LPA_INF ? l->gv[t] : LPA_INF;
+				bad += c != dijkstra_cost(&g, s, t);
+			}
+			char what[64];
+			snprintf(what, sizeof(what), "LPA* repairs match Dijkstra on %s, seed %d", gen_names[gen], seed);
+			check(!bad, what);
+			lpa_free(l);
+			grid_free(&g);
+		}
+	}
+}
+
+
+/* GIF: a strict reader. Every image must decode to exactly its pixel
+   count, end with the end code at the decoder's code width, and leave
+   nothing but padding after it. */
+static int gif_lzw_check(const unsigned char *d, size_t n, int min_size, long want) {
+	static int len[4096];
+	int clear = 1 << min_size, size = min_size + 1, avail = clear + 2, prev = -1;
+	size_t bit = 0;
+	long got = 0;
+	for (int i=0; i<clear; i++) len[i] = 1;
+	for (;;) {
+		if (bit + size > n*8) return -1;
+		int code = 0;
+		for (int k=0; k<size; k++, bit++) code |= ((d[bit >> 3] >> (bit & 7)) & 1) << k;
+		if (code == clear) {
+			size = min_size + 1;
+			avail = clear + 2;
+			prev = -1;
+			continue;
+		}
+		if (code == clear + 1) break;
+		if (prev < 0) {
+			if (code > clear) return -1;
+			got++;
+			prev = code;
+			continue;
+		}
+		if (code > avail || (code == avail && avail == 4096)) return -1;
+		got += code == avail ? len[prev] + 1 : len[code];
+		if (avail < 4096) {
+			len[avail++] = len[prev] + 1;
+			if (avail == (1 << size) && size < 12) size++;
+		}
+		prev = code;
+	}
+	return got == want && (bit + 7) / 8 == n ? 0 : -1;
+}
+
+/* returns the number of frames, -1 if the file is malformed */
+static long gif_check(const char *path) {
+	size_t len, p;
+	unsigned char *d = read_file(path, &len);
+	long frames = -1;
+	if (!d || len < 13 || memcmp(d, "GIF89a", 6)) goto done;
+	int cw = d[6] | d[7] << 8, ch = d[8] | d[9] << 8;
+	p = 13 + (d[10] & 0x80 ? 3 * (2 << (d[10] & 7)) : 0);
+	unsigned char *buf = xmalloc(len);
+	for (long n = 0; p < len; ) {
+		unsigned char b = d[p++];
+		if (b == 0x3B) {
+			if (p == len) frames = n;
+			break;
+		}
+		if (b == 0x21 && p < len) p++;
+		else if (b == 0x2C && p + 10 <= len) {
+			int x = d[p] | d[p+1] << 8, y = d[p+2] | d[p+3] << 8;
+			int w = d[p+4] | d[p+5] << 8, h = d[p+6] | d[p+7] << 8;
+			if (w < 1 || h < 1 || x + w > cw || y + h > ch || d[p+8]) break;
+			int min_size = d[p+9];
+			p += 10;
+			size_t blen = 0;
+			while (p < len && d[p] && p + 1 + d[p] <= len) {
+				memcpy(buf + blen, d + p + 1, d[p]);
+				blen += d[p];
+				p += 1 + d[p];
+			}
+			if (p++ >= len || min_size < 2 || min_size > 8) break;
+			if (gif_lzw_check(buf, blen, min_size, (long)w*h)) break;
+			n++;
+			continue;
+		} else break;
+		/* extension: skip its sub-blocks */
+		while (p < len && d[p]) p += 1 + d[p];
+		if (p++ >= len) break;
+	}
+	free(buf);
+done:
+	free(d);
+	return frames;
+}
+
+typedef struct {
+	Recorder *rc;
+	int sr, sc, er, ec;
+} Rec;
+static void rec_step(void *ctx, const Grid *g, int cell, int before) {
+	Rec *r = ctx;
+	(void)cell;
+	(void)before;
+	recorder_step(r->rc, g, r->sr, r->sc, r->er, r->ec);
+}
+
+static void test_gif(void) {
+	static const struct { int gen, algo, rows, cols, scale; } runs[] = {
+		{ MAZE_GEN_ROOMS, MAZE_BFS, 61, 91, 1 }, { MAZE_GEN_ROOMS, MAZE_ASTAR, 101, 101, 2 },
+		{ MAZE_GEN_MAZE, MAZE_DFS, 81, 81, 1 }, { MAZE_GEN_TERRAIN, MAZE_DIJKSTRA, 61, 61, 3 },
+		{ MAZE_GEN_MAZE, MAZE_HPA, 41, 61, 1 },
+	};
+	const char *path = scratch("core_test.gif");
+	for (size_t i=0; i<sizeof(runs)/sizeof(runs[0]); i++) {
+		Grid g;
+		grid_init(&g, runs[i].rows, runs[i].cols);
+		rng_seed(i + 1);
+		run_generator(runs[i].gen, &g);
+		Rec r = { recorder_open(path, &g, 1, runs[i].scale), 1, 1, g.rows-2, g.cols-2 };
+		check(r.rc != NULL, "recorder_open");
+		if (!r.rc) continue;
+		MazeObserver o = { NULL, rec_step, rec_step, NULL, &r };
+		run_solver(runs[i].algo, &g, r.sr, r.sc, r.er, r.ec, &o);
+		long frames = recorder_close(r.rc, &g, r.sr, r.sc, r.er, r.ec);
+		char what[64];
+		snprintf(what, sizeof(what), "every GIF frame decodes (run %d)", (int)i);
+		check(frames > 1 && gif_check(path) == frames, what);
+		grid_free(&g);
+	}
+	remove(path);
+}
+
+/* PNG: a reader for what export_image writes (8-bit RGB, fixed-Huffman or
+   stored deflate blocks), checking every CRC and the Adler-32 */
+typedef struct {
+	const unsigned char *d;
+	size_t n, bit;
+} Bits;
+static int bits_get(Bits *b, int n) {
+	int v = 0;
+	for (int i=0; i<n; i++, b->bit++) {
+		if (b->bit >= b->n*8) return -1;
+		v |= ((b->d[b->bit >> 3] >> (b->bit & 7)) & 1) << i;
+	}
+	return v;
+}
+/* one fixed-Huffman literal/length symbol, -1 on a bad code */
+static int fixed_sym(Bits *b) {
+	int code = 0;
+	for (int len=1; len<=9; len++) {
+		int bit = bits_get(b, 1);
+		if (bit < 0) return -1;
+		code = code << 1 | bit;
+		if (len == 7 && code <= 23) return 256 + code;
+		if (len == 8 && code >= 48 && code <= 191) return code - 48;
+		if (len == 8 && code >= 192 && code <= 199) return 280 + code - 192;
+		if (len == 9 && code >= 400) return 144 + code - 400;
+	}
+	return -1;
+}
+/* inflates a zlib stream into out (exactly cap bytes), 0 on success */
+static int inflate_zlib(const unsigned char *d, size_t n, unsigned char *out, size_t cap) {
+	static const short lbase[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+	static const unsigned char lextra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+	static const int dbase[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,
+	                              4097,6145,8193,12289,16385,24577};
+	if (n < 6 || (d[0] & 0x0F) != 8 || ((d[0] << 8) | d[1]) % 31) return -1;
+	Bits b = { d + 2, n - 6, 0 };
+	size_t len = 0;
+	for (int final = 0; !final; ) {
+		final = bits_get(&b, 1);
+		int type = bits_get(&b, 2);
+		if (final < 0 || type < 0) return -1;
+		if (type == 0) {
+			b.bit = (b.bit + 7) & ~(size_t)7;
+			size_t at = b.bit >> 3;
+			if (at + 4 > b.n) return -1;
+			size_t k = b.d[at] | b.d[at+1] << 8;
+			if ((k ^ (b.d[at+2] | b.d[at+3] << 8)) != 0xFFFF || at + 4 + k > b.n || len + k > cap) return -1;
+			memcpy(out + len, b.d + at + 4, k);
+			len += k;
+			b.bit = (at + 4 + k) * 8;
+			continue;
+		}
+		if (type != 1) return -1;
+		for (;;) {
+			int sym = fixed_sym(&b);
+			if (sym < 0 || sym > 285) return -1;
+			if (sym < 256) {
+				if (len == cap) return -1;
+				out[len++] = (unsigned char)sym;
+				continue;
+			}
+			if (sym == 256) break;
+			int ml = lbase[sym-257] + bits_get(&b, lextra[sym-257]);
+			int dc = 0;
+			for (int i=0; i<5; i++) dc = dc << 1 | bits_get(&b, 1);
+			if (dc > 29) return -1;
+			size_t dist = dbase[dc] + bits_get(&b, dc < 4 ? 0 : dc/2 - 1);
+			if (dist > len || len + ml > cap) return -1;
+			for (int i=0; i<ml; i++, len++) out[len] = out[len - dist];
+		}
+	}
+	if (len != cap || ((b.bit + 7) >> 3) != b.n) return -1;
+	unsigned a = 1, s = 0;
+	for (size_t i=0; i<len; i++) {
+		a = (a + out[i]) % 65521;
+		s = (s + a) % 65521;
+	}
+	return get_be32(d + n - 4) == (s << 16 | a) ? 0 : -1;
+}
+
+static unsigned crc32_png(const unsigned char *p, size_t n) {
+	unsigned crc = 0xFFFFFFFFu;
+	for (size_t i=0; i<n; i++) {
+		crc ^= p[i];
+		for (int k=0; k<8; k++) crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
+static int paeth(int a, int b, int c) {
+	int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+/* decodes an 8-bit RGB PNG into *rgb, 0 on success */
+static int png_decode(const char *path, long *w, long *h, unsigned char **rgb) {
+	static const unsigned char sig[8] = { 137,'P','N','G',13,10,26,10 };
+	size_t len, p = 8, zlen = 0;
+	unsigned char *d = read_file(path, &len), *z = NULL, *raw = NULL;
+	int ok = 0, ended = 0;
+	*rgb = NULL;
+	if (!d || len < 8 || memcmp(d, sig, 8)) goto done;
+	z = xmalloc(len);
+	*w = *h = 0;
+	while (!ended && p + 12 <= len) {
+		size_t n = get_be32(d + p);
+		const unsigned char *type = d + p + 4, *data = d + p + 8;
+		if (n > len - p - 12 || crc32_png(type, n + 4) != get_be32(data + n)) goto done;
+		if (!memcmp(type, "IHDR", 4)) {
+			if (n != 13 || data[8] != 8 || data[9] != 2 || data[10] || data[11] || data[12]) goto done;
+			*w = get_be32(data);
+			*h = get_be32(data + 4);
+		} else if (!memcmp(type, "IDAT", 4)) {
+			memcpy(z + zlen, data, n);
+			zlen += n;
+		} else if (!memcmp(type, "IEND", 4)) ended = 1;
+		p += n + 12;
+	}
+	if (!ended || p != len || *w < 1 || *h < 1) goto done;
+	size_t stride = 3 * *w + 1;
+	raw = xmalloc(stride * *h);
+	if (inflate_zlib(z, zlen, raw, stride * *h)) goto done;
+	*rgb = xmalloc(3 * *w * *h);
+	for (long y=0; y<*h; y++) {
+		const unsigned char *in = raw + y*stride + 1;
+		unsigned char *out = *rgb + 3*(*w)*y, *up = y ? out - 3*(*w) : NULL;
+		for (long x=0; x<3 * *w; x++) {
+			int a = x >= 3 ? out[x-3] : 0, b = up ? up[x] : 0, c = up && x >= 3 ? up[x-3] : 0, v;
+			switch (in[-1]) {
+			case 0: v = 0; break;
+			case 1: v = a; break;
+			case 2: v = b; break;
+			case 3: v = (a + b) / 2; break;
+			case 4: v = paeth(a, b, c); break;
+			default: goto done;
+			}
+			out[x] = (unsigned char)(in[x] + v);
+		}
+	}
+	ok = 1;
+done:
+	if (!ok) {
+		free(*rgb);
+		*rgb = NULL;
+	}
+	free(d);
+	free(z);
+	free(raw);
+	return ok ? 0 : -1;
+}
+
+/* a solved grid exports to the same pixels as PNG and as PPM */
+static void test_png(void) {
+	static const struct { int gen, algo, scale; } runs[] = {
+		{ MAZE_GEN_TERRAIN, MAZE_DIJKSTRA, 1 }, { MAZE_GEN_TERRAIN, MAZE_ASTAR, 3 },
+		{ MAZE_GEN_ROOMS, MAZE_BFS, 2 }, { MAZE_GEN_MAZE, MAZE_JPS, 1 },
+	};
+	char png[1024], ppm[1024];
+	snprintf(png, sizeof png, "%s/core_test.png", dir);
+	snprintf(ppm, sizeof ppm, "%s/core_test.ppm", dir);
+	for (size_t i=0; i<sizeof(runs)/sizeof(runs[0]); i++) {
+		Grid g;
+		grid_init(&g, 61, 91);
+		rng_seed(i + 21);
+		run_generator(runs[i].gen, &g);
+		run_solver(runs[i].algo, &g, 1, 1, g.rows-2, g.cols-2, NULL);
+		scratch_reset();
+		int sc = runs[i].scale;
+		check(!export_image(&g, 1, 1, g.rows-2, g.cols-2, sc, png)
+		      && !export_image(&g, 1, 1, g.rows-2, g.cols-2, sc, ppm), "export_image");
+		long w, h;
+		unsigned char *pix;
+		size_t plen;
+		unsigned char *pp = read_file(ppm, &plen);
+		char head[64];
+		int hlen = snprintf(head, sizeof head, "P6\n%d %d\n255\n", g.cols * sc, g.rows * sc);
+		int ok = !png_decode(png, &w, &h, &pix) && w == (long)g.cols * sc && h == (long)g.rows * sc
+		         && pp && plen == (size_t)(hlen + 3*w*h) && !memcmp(pp, head, hlen) && !memcmp(pp + hlen, pix, 3*w*h);
+		char what[64];
+		snprintf(what, sizeof(what), "PNG decodes to the PPM's pixels (run %d)", (int)i);
+		check(ok, what);
+		free(pix);
+		free(pp);
+		grid_free(&g);
+	}
+	remove(png);
+	remove(ppm);
+}
+
+/* recording and export keep no shared state: threads writing their own
+   grids produce the same files as one thread writing them in turn */
+#define RENDER_THREADS 4
+typedef struct {
+	int id;
+	char gif[1024], png[1024];
+} RenderJob;
+static void *render_job(void *arg) {
+	RenderJob *j = arg;
+	Grid g;
+	grid_init(&g, 61, 81);
+	rng_seed(j->id + 10);
+	run_generator(j->id % GEN_COUNT, &g);
+	Rec r = { recorder_open(j->gif, &g, 3, 2), 1, 1, g.rows-2, g.cols-2 };
+	MazeObserver o = { NULL, rec_step, rec_step, NULL, &r };
+	if (r.rc) {
+		run_solver(MAZE_ASTAR, &g, r.sr, r.sc, r.er, r.ec, &o);
+		recorder_close(r.rc, &g, r.sr, r.sc, r.er, r.ec);
+	}
+	export_image(&g, r.sr, r.sc, r.er, r.ec, 3, j->png);
+	grid_free(&g);
+	maze_thread_release();
+	return NULL;
+}
+static int same_file(const char *a, const char *b) {
+	size_t la, lb;
+	unsigned char *da = read_file(a, &la), *db = read_file(b, &lb);
+	int same = da && db && la == lb && !memcmp(da, db, la);
+	free(da);
+	free(db);
+	return same;
+}
+
+static void test_threads(void) {
+	RenderJob seq[RENDER_THREADS], par[RENDER_THREADS];
+	thread_t tid[RENDER_THREADS];
+	for (int i=0; i<RENDER_THREADS; i++) {
+		seq[i].id = par[i].id = i;
+		snprintf(seq[i].gif, sizeof seq[i].gif, "%s/core_test_s%d.gif", dir, i);
+		snprintf(seq[i].png, sizeof seq[i].png, "%s/core_test_s%d.png", dir, i);
+		snprintf(par[i].gif, sizeof par[i].gif, "%s/core_test_p%d.gif", dir, i);
+		snprintf(par[i].png, sizeof par[i].png, "%s/core_test_p%d.png", dir, i);
+		render_job(&seq[i]);
+	}
+	for (int i=0; i<RENDER_THREADS; i++) thread_start(&tid[i], render_job, &par[i]);
+	for (int i=0; i<RENDER_THREADS; i++) thread_join(tid[i]);
+	for (int i=0; i<RENDER_THREADS; i++) {
+		check(gif_check(par[i].gif) > 1 && same_file(seq[i].gif, par[i].gif), "GIF recorded alongside other threads");
+		check(same_file(seq[i].png, par[i].png), "PNG exported alongside other threads");
+		remove(seq[i].gif);
+		remove(seq[i].png);
+		remove(par[i].gif);
+		remove(par[i].png);
+	}
+}
+
+
+int main(int argc, char **argv) {
+	if (argc > 1) dir = argv[1];
+	test_hpa();
+	test_jps();
+	test_lpa();
+	test_png();
+	test_gif();
+	test_threads();
+	maze_thread_release();
+	printf("core_test: %d checks, %d failed\n", checks, failed);
+	return failed != 0;
+}